@@ -0,0 +1,138 @@
+
+/* bench_latency.cpp */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include <sys/wait.h>
+
+#include "shm_comm.h"
+
+static void RunSubscriber(const char* sharedMemoryName,
+                          int cpu,
+                          int numaNode)
+{
+    DataSubscriber<long, long> dataSub;
+    ShmCommOptions options;
+    options.mNumaNode = numaNode;
+
+    if (cpu >= 0 && !ShmPinThread(cpu))
+        _exit(EXIT_FAILURE);
+
+    /* Same node as the publisher, whichever side touches a page first */
+    if (!dataSub.Initialize(sharedMemoryName, options))
+        _exit(EXIT_FAILURE);
+
+    while (dataSub.Subscribe()) {
+        long resultData = dataSub.GetData() + 1;
+        dataSub.SendResult(resultData);
+    }
+
+    _exit(EXIT_SUCCESS);
+}
+
+static bool RunPlacement(const char* placementName,
+                         int publisherCpu,
+                         int subscriberCpu,
+                         int numaNode,
+                         int numOfIterations)
+{
+    const char* sharedMemoryName = "/bench_latency";
+    DataPublisher<long, long> dataPub;
+    ShmCommOptions options;
+    options.mNumaNode = numaNode;
+
+    if (publisherCpu >= 0 && !ShmPinThread(publisherCpu))
+        return false;
+
+    if (!dataPub.Initialize(sharedMemoryName, options)) {
+        std::cerr << "Benchmark: initialization failed" << std::endl;
+        return false;
+    }
+
+    pid_t pid = fork();
+
+    if (pid == -1) {
+        std::cerr << "Error: fork() failed" << std::endl;
+        return false;
+    }
+
+    if (pid == 0)
+        RunSubscriber(sharedMemoryName, subscriberCpu, numaNode);
+
+    /* Warm up caches and page tables */
+    for (long i = 0; i < 1000; ++i) {
+        dataPub.Publish(i);
+        dataPub.WaitForResult();
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    for (long i = 0; i < numOfIterations; ++i) {
+        dataPub.Publish(i);
+        dataPub.WaitForResult();
+    }
+
+    auto endTime = std::chrono::steady_clock::now();
+
+    dataPub.Stop();
+    waitpid(pid, NULL, 0);
+    dataPub.Destroy();
+
+    double elapsedNs = std::chrono::duration<double, std::nano>(
+        endTime - startTime).count();
+
+    std::cout << placementName
+              << ": publisher cpu " << publisherCpu
+              << ", subscriber cpu " << subscriberCpu
+              << ", node " << numaNode
+              << ": " << elapsedNs / numOfIterations
+              << " ns per round trip" << std::endl;
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    int numOfIterations = argc > 1 ? std::atoi(argv[1]) : 100000;
+
+    const struct {
+        const char*  mName;
+        ShmPlacement mPlacement;
+    } placements[] = {
+        { "same core",  ShmPlacement::SameCore  },
+        { "same cache", ShmPlacement::SameCache },
+        { "same node",  ShmPlacement::SameNode  },
+        { "cross node", ShmPlacement::CrossNode },
+    };
+
+    /* Baseline left to the scheduler and first-touch page placement */
+    if (!RunPlacement("unpinned", -1, -1, -1, numOfIterations))
+        return EXIT_FAILURE;
+
+    for (const auto& placement : placements) {
+        int publisherCpu;
+        int subscriberCpu;
+        int numaNode;
+
+        if (!ShmFindCpuPair(placement.mPlacement,
+                            publisherCpu, subscriberCpu, numaNode)) {
+            std::cout << placement.mName
+                      << ": not available on this host" << std::endl;
+            continue;
+        }
+
+        /* Each placement runs in its own process to reset the affinity */
+        pid_t pid = fork();
+
+        if (pid == 0)
+            _exit(RunPlacement(placement.mName, publisherCpu,
+                               subscriberCpu, numaNode, numOfIterations) ?
+                  EXIT_SUCCESS : EXIT_FAILURE);
+
+        waitpid(pid, NULL, 0);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -4,14 +4,29 @@
 #ifndef SHM_COMM_H
 #define SHM_COMM_H
 
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <type_traits>
+
 #include <fcntl.h>
 #include <pthread.h>
+#include <signal.h>
 #include <unistd.h>
 
+#include <linux/futex.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 
+#include "shm_journal.h"
+#include "shm_numa.h"
+
 /*
  * ShmCommState enum definitions
  */
@@ -24,6 +39,303 @@ enum ShmCommState
     GotResult  = 3,
 };
 
+/*
+ * ShmCommOptions struct definitions
+ */
+
+struct ShmCommOptions
+{
+    ShmCommOptions() : mNumaNode(-1), mArenaSize(0) { }
+
+    /* NUMA node the segment pages are bound to (-1 for first touch) */
+    int         mNumaNode;
+    /* Initial size of the arena behind the fixed layout, grown later
+     * with DataPublisher::Resize() */
+    std::size_t mArenaSize;
+};
+
+/*
+ * ShmSegmentHeader struct definitions
+ *
+ * Placed at the beginning of every segment so that either side can attach
+ * first and a restarted process can tell a live segment from a stale or
+ * incompatible one. mInitialized and mSubscriberAttached are futex words.
+ * mSegmentSize is the current size of the shared memory object, which
+ * subscribers and other publishers compare with the size they have
+ * mapped in Remap().
+ */
+
+static const std::uint64_t ShmSegmentMagic   = 0x4d4d4f434d4853ULL;
+static const std::uint32_t ShmSegmentVersion = 1;
+
+struct ShmSegmentHeader
+{
+    std::uint64_t mMagic;
+    std::uint32_t mVersion;
+    std::uint32_t mInitialized;
+    std::uint64_t mLayoutHash;
+    std::uint32_t mSubscriberAttached;
+    std::uint64_t mSegmentSize;
+};
+
+/*
+ * Synchronization helper functions
+ */
+
+inline void ShmFutexWait(std::uint32_t* pWord, std::uint32_t expected)
+{
+    /* Shared futex (no FUTEX_PRIVATE_FLAG) since the word is in a
+     * segment mapped by several processes */
+    syscall(SYS_futex, pWord, FUTEX_WAIT, expected, NULL, NULL, 0);
+}
+
+inline void ShmFutexWake(std::uint32_t* pWord)
+{
+    syscall(SYS_futex, pWord, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+/* Mutexes are robust: if a process dies holding one, the next owner
+ * gets it back instead of blocking forever */
+inline void ShmMutexLock(pthread_mutex_t* pMutex)
+{
+    if (pthread_mutex_lock(pMutex) == EOWNERDEAD)
+        pthread_mutex_consistent(pMutex);
+}
+
+inline void ShmCondWait(pthread_cond_t* pCond, pthread_mutex_t* pMutex)
+{
+    if (pthread_cond_wait(pCond, pMutex) == EOWNERDEAD)
+        pthread_mutex_consistent(pMutex);
+}
+
+/* Condition variables use CLOCK_MONOTONIC, so that timed waits are not
+ * affected by changes of the system time */
+inline void ShmCondTimedWait(pthread_cond_t* pCond,
+                             pthread_mutex_t* pMutex,
+                             long timeoutMs)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeoutMs / 1000;
+    deadline.tv_nsec += (timeoutMs % 1000) * 1000000L;
+
+    if (deadline.tv_nsec >= 1000000000L) {
+        ++deadline.tv_sec;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    if (pthread_cond_timedwait(pCond, pMutex, &deadline) == EOWNERDEAD)
+        pthread_mutex_consistent(pMutex);
+}
+
+/* Interval at which waits on a peer that may have died check whether it
+ * is still alive */
+static const long ShmLivenessCheckMs = 100;
+
+/* A process is only known to be dead if signalling it fails with ESRCH;
+ * 0 means that no process has been recorded */
+inline bool ShmProcessDead(pid_t pid)
+{
+    return pid != 0 && kill(pid, 0) == -1 && errno == ESRCH;
+}
+
+/*
+ * ShmDirtyRange struct definitions
+ *
+ * Byte range of the request that changed since the previous one. The
+ * subscriber gets the ranges written by the last publish, so that it can
+ * update its own state incrementally.
+ */
+
+static const std::size_t ShmMaxDirtyRanges = 32;
+static const std::size_t ShmDirtyLineSize  = 64;
+
+struct ShmDirtyRange
+{
+    std::uint32_t mOffset;
+    std::uint32_t mLength;
+};
+
+/* Compare two objects cache line by cache line (memcmp is vectorized by
+ * the C library) and collect the runs of differing lines; if there are
+ * more runs than ranges, the last range is extended to cover the rest */
+inline std::size_t ShmFindDirtyRanges(const void* pPrevious,
+                                      const void* pCurrent,
+                                      std::size_t size,
+                                      ShmDirtyRange* pRanges)
+{
+    const unsigned char* pPrev = static_cast<const unsigned char*>(pPrevious);
+    const unsigned char* pCurr = static_cast<const unsigned char*>(pCurrent);
+    std::size_t numRanges = 0;
+
+    for (std::size_t offset = 0; offset < size; offset += ShmDirtyLineSize) {
+        std::size_t length = size - offset < ShmDirtyLineSize ?
+                             size - offset : ShmDirtyLineSize;
+
+        if (std::memcmp(pPrev + offset, pCurr + offset, length) == 0)
+            continue;
+
+        ShmDirtyRange* pLast = numRanges > 0 ? &pRanges[numRanges - 1] : NULL;
+
+        if (pLast != NULL &&
+            (pLast->mOffset + pLast->mLength == offset ||
+             numRanges == ShmMaxDirtyRanges)) {
+            pLast->mLength = offset + length - pLast->mOffset;
+        } else {
+            pRanges[numRanges].mOffset = offset;
+            pRanges[numRanges].mLength = length;
+            ++numRanges;
+        }
+    }
+
+    return numRanges;
+}
+
+/*
+ * ShmPayload struct definitions
+ *
+ * Storage for the request and the result in the segment. By default both
+ * have their own space; DataPublisher<DataType, InPlaceResult<ResultType>>
+ * selects the in-place mode, in which the subscriber writes its result
+ * over the request it has consumed and the segment only needs room for
+ * the larger of the two. DataPublisher<DataType, StreamResult<ResultType,
+ * Depth>> selects the streaming mode, in which the subscriber sends any
+ * number of partial results through a ring of Depth slots.
+ */
+
+template <typename ResultType>
+struct InPlaceResult;
+
+template <typename ResultType, std::size_t Depth>
+struct StreamResult;
+
+template <typename DataType, typename ResultType>
+struct ShmPayload
+{
+    typedef ResultType ResultValueType;
+    static const bool IsInPlace = false;
+    static const bool IsStream = false;
+
+    inline DataType& Data() { return this->mData; }
+    inline ResultType& Result() { return this->mResult; }
+
+    DataType   mData;
+    ResultType mResult;
+};
+
+template <typename DataType, typename ResultType>
+struct ShmPayload<DataType, InPlaceResult<ResultType>>
+{
+    typedef ResultType ResultValueType;
+    static const bool IsInPlace = true;
+    static const bool IsStream = false;
+
+    /* Union takes the stricter alignment of the two, so only the size
+     * has to be checked */
+    static_assert(sizeof(ResultType) <= sizeof(DataType),
+                  "In-place result must fit into the request buffer");
+    static_assert(std::is_trivially_copyable<DataType>::value &&
+                  std::is_trivially_copyable<ResultType>::value,
+                  "In-place request and result must be trivially copyable");
+
+    inline DataType& Data() { return this->mData; }
+    inline ResultType& Result() { return this->mResult; }
+
+    union {
+        DataType   mData;
+        ResultType mResult;
+    };
+};
+
+template <typename DataType, typename ResultType, std::size_t Depth>
+struct ShmPayload<DataType, StreamResult<ResultType, Depth>>
+{
+    typedef ResultType ResultValueType;
+    static const bool IsInPlace = false;
+    static const bool IsStream = true;
+
+    static_assert(Depth > 0, "Result ring needs at least one slot");
+
+    inline DataType& Data() { return this->mData; }
+    /* Most recently sent result, i.e. the final one once complete */
+    inline ResultType& Result()
+    { return this->mRing[(this->mTail - 1) % Depth]; }
+
+    inline bool RingFull() const { return this->mTail - this->mHead == Depth; }
+    inline bool RingEmpty() const { return this->mTail == this->mHead; }
+    inline ResultType& PopRing() { return this->mRing[this->mHead++ % Depth]; }
+    inline void PushRing(const ResultType& result)
+    { this->mRing[this->mTail++ % Depth] = result; }
+
+    /* Discard unread results but keep the last one readable */
+    inline void ResetRing()
+    {
+        this->mHead = this->mTail;
+        this->mFinal = false;
+    }
+
+    DataType      mData;
+    ResultType    mRing[Depth];
+    /* Never wrap in practice, so slots stay distinct for any Depth */
+    std::uint64_t mHead;
+    std::uint64_t mTail;
+    bool          mFinal;
+};
+
+/*
+ * Layout hash functions
+ */
+
+template <typename T>
+constexpr const char* ShmTypeName()
+{
+    /* Contains the spelled-out type, e.g. "... [with T = int]" */
+    return __PRETTY_FUNCTION__;
+}
+
+constexpr std::uint64_t ShmHashString(const char* pString,
+                                      std::uint64_t hash)
+{
+    /* FNV-1a */
+    for (; *pString != '\0'; ++pString)
+        hash = (hash ^ static_cast<unsigned char>(*pString)) *
+               0x100000001b3ULL;
+
+    return hash;
+}
+
+constexpr std::uint64_t ShmHashValue(std::uint64_t value,
+                                     std::uint64_t hash)
+{
+    for (int i = 0; i < 8; ++i, value >>= 8)
+        hash = (hash ^ (value & 0xff)) * 0x100000001b3ULL;
+
+    return hash;
+}
+
+/* Hash of the identity, size and alignment of the types sharing a
+ * segment; both sides must be built with the same compiler for the type
+ * names to agree */
+template <typename SharedType, typename DataType, typename ResultType>
+constexpr std::uint64_t ShmLayoutHash()
+{
+    typedef typename ShmPayload<DataType, ResultType>::ResultValueType
+        ResultValueType;
+
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+
+    hash = ShmHashString(ShmTypeName<DataType>(), hash);
+    hash = ShmHashString(ShmTypeName<ResultType>(), hash);
+    hash = ShmHashValue(sizeof(DataType), hash);
+    hash = ShmHashValue(alignof(DataType), hash);
+    hash = ShmHashValue(sizeof(ResultValueType), hash);
+    hash = ShmHashValue(alignof(ResultValueType), hash);
+    hash = ShmHashValue(sizeof(SharedType), hash);
+    hash = ShmHashValue(alignof(SharedType), hash);
+
+    return hash;
+}
+
 template <typename DataType, typename ResultType>
 class DataPublisher;
 
@@ -51,17 +363,26 @@ private:
     SharedData& operator=(SharedData&& other);
 
 private:
-    ShmCommState    mState;
-    bool            mPublisherActive;
-    bool            mSubscriberActive;
-    DataType        mData;
-    ResultType      mResult;
-    pthread_mutex_t mMutex;
-    pthread_cond_t  mCondPublisherReady;
-    pthread_cond_t  mCondSubscriberReady;
-    pthread_cond_t  mCondSubscribed;
-    pthread_cond_t  mCondGotResult;
-    pthread_cond_t  mCondSubscriberDone;
+    ShmSegmentHeader                 mHeader;
+    ShmCommState                     mState;
+    bool                             mPublisherActive;
+    bool                             mSubscriberActive;
+    unsigned int                     mWaiters;
+    pid_t                            mCreatorPid;
+    pid_t                            mSubscriberPid;
+    pid_t                            mOwnerPid;
+    unsigned int                     mOwnerWaiters;
+    std::uint64_t                    mDataGeneration;
+    std::uint32_t                    mNumDirtyRanges;
+    ShmDirtyRange                    mDirtyRanges[ShmMaxDirtyRanges];
+    ShmPayload<DataType, ResultType> mPayload;
+    pthread_mutex_t                  mMutex;
+    pthread_cond_t                   mCondPublisherReady;
+    pthread_cond_t                   mCondSubscriberReady;
+    pthread_cond_t                   mCondSubscribed;
+    pthread_cond_t                   mCondGotResult;
+    pthread_cond_t                   mCondSubscriberDone;
+    pthread_cond_t                   mCondStream;
 };
 
 /*
@@ -74,18 +395,50 @@ class DataPublisher
 public:
     typedef SharedData<DataType, ResultType>  SharedType;
     typedef SharedData<DataType, ResultType>* SharedPtrType;
+    typedef typename ShmPayload<DataType, ResultType>::ResultValueType
+        ResultValueType;
+
+    /* Variable-sized arena follows the fixed layout on its own cache line */
+    static const std::size_t ArenaOffset =
+        (sizeof(SharedType) + 63) & ~static_cast<std::size_t>(63);
 
 public:
     DataPublisher();
     ~DataPublisher();
 
     bool Initialize(const char* sharedMemoryName);
+    bool Initialize(const char* sharedMemoryName,
+                    const ShmCommOptions& options);
     void Destroy();
+    bool Resize(std::size_t arenaSize);
+    bool Remap();
+    void WaitForSubscriber();
     void Publish(DataType& sharedData);
+    template <typename WriterFn>
+    void PublishWith(WriterFn writer);
+    bool PublishCoalesced(DataType& sharedData);
+    void PublishDelta(const DataType& sharedData);
+    void PublishDelta(const DataType& sharedData,
+                      const ShmDirtyRange* pDirtyRanges,
+                      std::size_t numDirtyRanges);
     void WaitForResult();
+    void WaitForResult(ResultValueType& resultData);
+    bool WaitForLiveResult();
+    bool NextPartial(ResultValueType& partialData, bool& isFinal);
+    template <typename PartialFn, typename FinalFn>
+    void ForEachPartial(PartialFn partialCallback, FinalFn finalCallback);
     void Stop();
 
-    inline ResultType& GetResult() const { return this->mpShared->mResult; }
+    inline ResultValueType& GetResult() const
+    { return this->mpShared->mPayload.Result(); }
+    inline bool SubscriberAlive() const
+    { return !ShmProcessDead(this->mpShared->mSubscriberPid); }
+    inline void SetJournal(MessageJournal<DataType, ResultValueType>* pJournal)
+    { this->mpJournal = pJournal; }
+    inline void* GetArena() const
+    { return reinterpret_cast<char*>(this->mpShared) + ArenaOffset; }
+    inline std::size_t GetArenaSize() const
+    { return this->mMappedSize - ArenaOffset; }
 
 private:
     DataPublisher(const DataPublisher& other);
@@ -93,10 +446,22 @@ private:
     DataPublisher& operator=(const DataPublisher& other);
     DataPublisher& operator=(DataPublisher&& other);
 
+    void SetFullRange();
+    void SetOwner();
+    void ReleaseWaiter();
+    void WaitForSubscribed();
+
 private:
-    SharedPtrType mpShared;
-    const char*   mShmName;
-    int           mShmFd;
+    SharedPtrType                              mpShared;
+    const char*                                mShmName;
+    int                                        mShmFd;
+    std::size_t                                mMappedSize;
+    int                                        mNumaNode;
+    MessageJournal<DataType, ResultValueType>* mpJournal;
+    std::unique_ptr<DataType>                  mpLastPublished;
+    std::uint64_t                              mLastGeneration;
+    pid_t                                      mPid;
+    bool                                       mOwnsSegment;
 };
 
 /*
@@ -107,7 +472,13 @@ template <typename DataType, typename ResultType>
 DataPublisher<DataType, ResultType>::DataPublisher() :
     mpShared(NULL),
     mShmName(NULL),
-    mShmFd(-1)
+    mShmFd(-1),
+    mMappedSize(0),
+    mNumaNode(-1),
+    mpJournal(NULL),
+    mLastGeneration(0),
+    mPid(0),
+    mOwnsSegment(false)
 {
 }
 
@@ -120,6 +491,13 @@ DataPublisher<DataType, ResultType>::~DataPublisher()
 template <typename DataType, typename ResultType>
 bool DataPublisher<DataType, ResultType>::Initialize(
     const char* sharedMemoryName)
+{
+    return this->Initialize(sharedMemoryName, ShmCommOptions());
+}
+
+template <typename DataType, typename ResultType>
+bool DataPublisher<DataType, ResultType>::Initialize(
+    const char* sharedMemoryName, const ShmCommOptions& options)
 {
     if (!sharedMemoryName) {
         std::cerr << "Invalid shared memory name" << std::endl;
@@ -128,7 +506,8 @@ bool DataPublisher<DataType, ResultType>::Initialize(
     
     this->mShmName = sharedMemoryName;
 
-    /* Create Posix shared memory object */
+    /* Create Posix shared memory object, or open the one created by a
+     * subscriber that started first or by a previous publisher */
     this->mShmFd = shm_open(this->mShmName,
                             O_RDWR | O_CREAT,
                             S_IRUSR | S_IWUSR);
@@ -138,15 +517,38 @@ bool DataPublisher<DataType, ResultType>::Initialize(
         return false;
     }
 
-    /* Set the size of shared memory object */
-    if (ftruncate(this->mShmFd, sizeof(SharedType)) == -1) {
+    /* Set the size of shared memory object if it has just been created
+     * or is smaller than requested; it is never shrunk */
+    struct stat shmStat;
+
+    if (fstat(this->mShmFd, &shmStat) == -1) {
+        std::cerr << "Error: fstat() failed" << std::endl;
+        this->Destroy();
+        return false;
+    }
+
+    std::size_t shmSize = shmStat.st_size;
+    std::size_t mappedSize = ArenaOffset + options.mArenaSize;
+
+    if (shmSize != 0 && shmSize < sizeof(SharedType)) {
+        std::cerr << "Error: shared memory size mismatch" << std::endl;
+        this->Destroy();
+        return false;
+    }
+
+    if (shmSize > mappedSize)
+        mappedSize = shmSize;
+
+    if (shmSize < mappedSize &&
+        ftruncate(this->mShmFd, mappedSize) == -1) {
         std::cerr << "Error: ftruncate() failed" << std::endl;
+        this->Destroy();
         return false;
     }
 
     /* Map shared memory object to memory */
     void* pShared = mmap(NULL,
-                         sizeof(SharedType),
+                         mappedSize,
                          PROT_READ | PROT_WRITE,
                          MAP_SHARED,
                          this->mShmFd,
@@ -154,41 +556,152 @@ bool DataPublisher<DataType, ResultType>::Initialize(
     
     if (pShared == MAP_FAILED) {
         std::cerr << "Error: mmap() failed" << std::endl;
+        this->Destroy();
         return false;
     }
 
     /* Set the pointer to shared memory */
     this->mpShared = reinterpret_cast<SharedPtrType>(pShared);
+    this->mMappedSize = mappedSize;
+    this->mNumaNode = options.mNumaNode;
+    this->mPid = getpid();
+
+    /* Bind shared memory to NUMA node before this process touches it;
+     * pages a subscriber that started first has already faulted in stay
+     * where they are unless it was given the same node */
+    if (options.mNumaNode >= 0 &&
+        !ShmBindToNode(pShared, mappedSize, options.mNumaNode)) {
+        this->Destroy();
+        return false;
+    }
+
+    ShmSegmentHeader& header = this->mpShared->mHeader;
+    const std::uint64_t layoutHash =
+        ShmLayoutHash<SharedType, DataType, ResultType>();
+
+    /* Attach to a live segment without touching its primitives, which a
+     * subscriber may be waiting on */
+    if (__atomic_load_n(&header.mInitialized, __ATOMIC_ACQUIRE) != 0) {
+        if (header.mMagic != ShmSegmentMagic ||
+            header.mVersion != ShmSegmentVersion ||
+            header.mLayoutHash != layoutHash) {
+            std::cerr << "Error: shared memory layout mismatch" << std::endl;
+            this->Destroy();
+            return false;
+        }
+
+        ShmMutexLock(&this->mpShared->mMutex);
+
+        this->mpShared->mPublisherActive = true;
+
+        /* Take over the segment if the publisher that set it up died */
+        if (ShmProcessDead(this->mpShared->mCreatorPid)) {
+            this->mpShared->mCreatorPid = this->mPid;
+            this->mOwnsSegment = true;
+        }
+
+        /* Publisher of the request in flight may have died; its waiters
+         * are dropped, while other publishers that joined the request
+         * still collect the result. If nobody is left, an answered
+         * request is completed here and one still being processed is
+         * completed by the subscriber */
+        if ((this->mpShared->mState == ShmCommState::Published ||
+             this->mpShared->mState == ShmCommState::Subscribed) &&
+            ShmProcessDead(this->mpShared->mOwnerPid)) {
+            this->mpShared->mWaiters -= this->mpShared->mOwnerWaiters;
+            this->mpShared->mOwnerPid = 0;
+            this->mpShared->mOwnerWaiters = 0;
+            pthread_cond_broadcast(&this->mpShared->mCondStream);
+
+            if (this->mpShared->mWaiters == 0 &&
+                this->mpShared->mState == ShmCommState::Subscribed) {
+                this->mpShared->mState = ShmCommState::GotResult;
+                pthread_cond_broadcast(&this->mpShared->mCondGotResult);
+            }
+        }
+
+        /* Announce the size if the segment has just been grown */
+        if (header.mSegmentSize < mappedSize)
+            __atomic_store_n(&header.mSegmentSize, mappedSize,
+                             __ATOMIC_RELEASE);
+
+        pthread_mutex_unlock(&this->mpShared->mMutex);
+
+        return true;
+    }
 
     /* Initialize pthread mutex object */
     pthread_mutexattr_t mutexAttr;
     pthread_mutexattr_init(&mutexAttr);
     pthread_mutexattr_setpshared(&mutexAttr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&mutexAttr, PTHREAD_MUTEX_ROBUST);
     pthread_mutex_init(&this->mpShared->mMutex, &mutexAttr);
 
     /* Initialize pthread condition variable object */
     pthread_condattr_t condAttr;
     pthread_condattr_init(&condAttr);
     pthread_condattr_setpshared(&condAttr, PTHREAD_PROCESS_SHARED);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
     pthread_cond_init(&this->mpShared->mCondPublisherReady, &condAttr);
     pthread_cond_init(&this->mpShared->mCondSubscriberReady, &condAttr);
     pthread_cond_init(&this->mpShared->mCondSubscribed, &condAttr);
     pthread_cond_init(&this->mpShared->mCondGotResult, &condAttr);
     pthread_cond_init(&this->mpShared->mCondSubscriberDone, &condAttr);
+    pthread_cond_init(&this->mpShared->mCondStream, &condAttr);
 
     /* Initialize other members */
     this->mpShared->mState = ShmCommState::Init;
     this->mpShared->mPublisherActive = true;
     this->mpShared->mSubscriberActive = true;
+    this->mpShared->mCreatorPid = this->mPid;
+    this->mpShared->mSubscriberPid = 0;
+    this->mpShared->mWaiters = 0;
+    this->mpShared->mOwnerPid = 0;
+    this->mpShared->mOwnerWaiters = 0;
+    this->mpShared->mDataGeneration = 0;
+    this->mpShared->mNumDirtyRanges = 0;
+
+    if constexpr (ShmPayload<DataType, ResultType>::IsStream)
+        this->mpShared->mPayload.ResetRing();
+
+    /* Initialize segment header and wake subscribers that attached early */
+    header.mMagic = ShmSegmentMagic;
+    header.mVersion = ShmSegmentVersion;
+    header.mLayoutHash = layoutHash;
+    header.mSegmentSize = mappedSize;
+    __atomic_store_n(&header.mInitialized, 1, __ATOMIC_RELEASE);
+    ShmFutexWake(&header.mInitialized);
+
+    /* Primitives and segment are torn down by this publisher */
+    this->mOwnsSegment = true;
 
     return true;
 }
 
+template <typename DataType, typename ResultType>
+void DataPublisher<DataType, ResultType>::WaitForSubscriber()
+{
+    ShmSegmentHeader& header = this->mpShared->mHeader;
+    std::uint32_t numAttached;
+
+    /* Wait for the first subscriber to attach */
+    while ((numAttached = __atomic_load_n(&header.mSubscriberAttached,
+                                          __ATOMIC_ACQUIRE)) == 0)
+        ShmFutexWait(&header.mSubscriberAttached, numAttached);
+}
+
 template <typename DataType, typename ResultType>
 void DataPublisher<DataType, ResultType>::Destroy()
 {
-    if (this->mpShared != NULL) {
+    /* Only the publisher that set up the segment (or took it over from
+     * one that died) tears it down; other publishers just detach */
+    if (this->mpShared != NULL && this->mOwnsSegment) {
+        /* Segment must be set up again by the next publisher */
+        __atomic_store_n(&this->mpShared->mHeader.mInitialized, 0,
+                         __ATOMIC_RELEASE);
+
         /* Destroy condition variables */
+        pthread_cond_destroy(&this->mpShared->mCondStream);
         pthread_cond_destroy(&this->mpShared->mCondSubscriberDone);
         pthread_cond_destroy(&this->mpShared->mCondGotResult);
         pthread_cond_destroy(&this->mpShared->mCondSubscribed);
@@ -197,81 +710,541 @@ void DataPublisher<DataType, ResultType>::Destroy()
 
         /* Destroy mutex */
         pthread_mutex_destroy(&this->mpShared->mMutex);
-
-        /* Unmap shared memory */
-        munmap(this->mpShared, sizeof(SharedType));
     }
 
+    /* Unmap shared memory */
+    if (this->mpShared != NULL)
+        munmap(this->mpShared, this->mMappedSize);
+
     /* Close Posix shared memory object */
     if (this->mShmFd != -1)
         close(this->mShmFd);
 
-    /* Unlink Posix shared memory object */
-    if (this->mShmName != NULL)
+    /* Unlink Posix shared memory object (publisher owns the segment) */
+    if (this->mShmName != NULL && this->mOwnsSegment)
         shm_unlink(this->mShmName);
 
     this->mpShared = NULL;
     this->mShmName = NULL;
     this->mShmFd = -1;
+    this->mMappedSize = 0;
+    this->mOwnsSegment = false;
+}
+
+template <typename DataType, typename ResultType>
+bool DataPublisher<DataType, ResultType>::Resize(std::size_t arenaSize)
+{
+    std::size_t newSize = ArenaOffset + arenaSize;
+
+    /* Segment only grows, so that data in use stays where it is; the
+     * mapping of this publisher may move though, so no other thread may
+     * use it meanwhile (e.g. coalesced publishers waiting for a result).
+     * Publishers in other processes see the new size after Remap() */
+    if (newSize <= this->mMappedSize)
+        return true;
+
+    /* Grow shared memory object; mappings of other processes stay valid
+     * and only see the new pages once they remap */
+    if (ftruncate(this->mShmFd, newSize) == -1) {
+        std::cerr << "Error: ftruncate() failed" << std::endl;
+        return false;
+    }
+
+    void* pShared = mremap(this->mpShared, this->mMappedSize,
+                           newSize, MREMAP_MAYMOVE);
+
+    if (pShared == MAP_FAILED) {
+        std::cerr << "Error: mremap() failed" << std::endl;
+        return false;
+    }
+
+    this->mpShared = reinterpret_cast<SharedPtrType>(pShared);
+    this->mMappedSize = newSize;
+
+    /* Publish new size for subscribers to remap lazily; the object has
+     * grown even if binding the new pages fails below */
+    ShmMutexLock(&this->mpShared->mMutex);
+
+    __atomic_store_n(&this->mpShared->mHeader.mSegmentSize, newSize,
+                     __ATOMIC_RELEASE);
+
+    pthread_mutex_unlock(&this->mpShared->mMutex);
+
+    if (this->mNumaNode >= 0 &&
+        !ShmBindToNode(pShared, newSize, this->mNumaNode))
+        return false;
+
+    return true;
+}
+
+template <typename DataType, typename ResultType>
+bool DataPublisher<DataType, ResultType>::Remap()
+{
+    /* Picks up a Resize() done by another publisher process; like
+     * Resize(), it needs exclusive use of this publisher since the
+     * mapping may move, so it is not done implicitly by Publish() */
+    std::size_t segmentSize = __atomic_load_n(
+        &this->mpShared->mHeader.mSegmentSize, __ATOMIC_ACQUIRE);
+
+    if (segmentSize <= this->mMappedSize)
+        return true;
+
+    void* pShared = mremap(this->mpShared, this->mMappedSize,
+                           segmentSize, MREMAP_MAYMOVE);
+
+    if (pShared == MAP_FAILED) {
+        std::cerr << "Error: mremap() failed" << std::endl;
+        return false;
+    }
+
+    this->mpShared = reinterpret_cast<SharedPtrType>(pShared);
+    this->mMappedSize = segmentSize;
+
+    return true;
 }
 
 template <typename DataType, typename ResultType>
 void DataPublisher<DataType, ResultType>::Publish(DataType& sharedData)
 {
-    pthread_mutex_lock(&this->mpShared->mMutex);
+    /* Record data before taking the lock */
+    if (this->mpJournal != NULL)
+        this->mpJournal->AppendData(sharedData);
+
+    ShmMutexLock(&this->mpShared->mMutex);
 
     /* Wait for subscriber to get ready */
     while (this->mpShared->mState != ShmCommState::Init)
-        pthread_cond_wait(&this->mpShared->mCondSubscriberReady,
-                          &this->mpShared->mMutex);
+        ShmCondWait(&this->mpShared->mCondSubscriberReady,
+                    &this->mpShared->mMutex);
 
     /* Pass data object to subscriber */
-    this->mpShared->mData = sharedData;
+    this->mpShared->mPayload.Data() = sharedData;
+    this->SetFullRange();
     
+    /* Start a new request awaited only by this publisher */
+    this->SetOwner();
+
     /* Update the current state */
     this->mpShared->mState = ShmCommState::Published;
 
     /* Notify subscriber that publisher is ready */
     pthread_cond_signal(&this->mpShared->mCondPublisherReady);
+
+    /* Let queued publishers check whether they can join this request */
+    pthread_cond_broadcast(&this->mpShared->mCondSubscriberReady);
     
     pthread_mutex_unlock(&this->mpShared->mMutex);
 }
 
+template <typename DataType, typename ResultType>
+template <typename WriterFn>
+void DataPublisher<DataType, ResultType>::PublishWith(WriterFn writer)
+{
+    /* Journaled requests are staged and recorded before taking the lock,
+     * at the cost of the copy that writing in place otherwise saves */
+    if (this->mpJournal != NULL) {
+        DataType stagedData;
+        writer(stagedData);
+        this->Publish(stagedData);
+        return;
+    }
+
+    ShmMutexLock(&this->mpShared->mMutex);
+
+    /* Wait for subscriber to get ready */
+    while (this->mpShared->mState != ShmCommState::Init)
+        ShmCondWait(&this->mpShared->mCondSubscriberReady,
+                    &this->mpShared->mMutex);
+
+    /* Let caller write data object directly into shared memory */
+    writer(this->mpShared->mPayload.Data());
+    this->SetFullRange();
+
+    this->SetOwner();
+    this->mpShared->mState = ShmCommState::Published;
+
+    pthread_cond_signal(&this->mpShared->mCondPublisherReady);
+    pthread_cond_broadcast(&this->mpShared->mCondSubscriberReady);
+
+    pthread_mutex_unlock(&this->mpShared->mMutex);
+}
+
+template <typename DataType, typename ResultType>
+bool DataPublisher<DataType, ResultType>::PublishCoalesced(
+    DataType& sharedData)
+{
+    static_assert(!ShmPayload<DataType, ResultType>::IsInPlace,
+                  "In-place results overwrite the request to compare with");
+    static_assert(!ShmPayload<DataType, ResultType>::IsStream,
+                  "Streamed results cannot be shared by several publishers");
+
+    if (this->mpJournal != NULL)
+        this->mpJournal->AppendData(sharedData);
+
+    ShmMutexLock(&this->mpShared->mMutex);
+
+    /* Wait for subscriber to get ready, unless an equal request is
+     * already in flight, in which case this publisher attaches to it
+     * and receives the same result (requires DataType::operator==) */
+    while (this->mpShared->mState != ShmCommState::Init) {
+        if ((this->mpShared->mState == ShmCommState::Published ||
+             this->mpShared->mState == ShmCommState::Subscribed) &&
+            this->mpShared->mPayload.Data() == sharedData) {
+            ++this->mpShared->mWaiters;
+
+            if (this->mpShared->mOwnerPid == this->mPid)
+                ++this->mpShared->mOwnerWaiters;
+
+            pthread_mutex_unlock(&this->mpShared->mMutex);
+            return true;
+        }
+
+        ShmCondWait(&this->mpShared->mCondSubscriberReady,
+                    &this->mpShared->mMutex);
+    }
+
+    /* No matching request in flight, so publish a new one */
+    this->mpShared->mPayload.Data() = sharedData;
+    this->SetFullRange();
+    this->SetOwner();
+    this->mpShared->mState = ShmCommState::Published;
+
+    pthread_cond_signal(&this->mpShared->mCondPublisherReady);
+    pthread_cond_broadcast(&this->mpShared->mCondSubscriberReady);
+
+    pthread_mutex_unlock(&this->mpShared->mMutex);
+
+    return false;
+}
+
+template <typename DataType, typename ResultType>
+void DataPublisher<DataType, ResultType>::PublishDelta(
+    const DataType& sharedData)
+{
+    /* Without a previous copy everything is dirty */
+    if (!this->mpLastPublished) {
+        this->PublishDelta(sharedData, NULL, 0);
+        return;
+    }
+
+    /* Detect modified cache lines before taking the lock */
+    ShmDirtyRange dirtyRanges[ShmMaxDirtyRanges];
+    std::size_t numDirtyRanges = ShmFindDirtyRanges(
+        this->mpLastPublished.get(), &sharedData,
+        sizeof(DataType), dirtyRanges);
+
+    this->PublishDelta(sharedData, dirtyRanges, numDirtyRanges);
+}
+
+template <typename DataType, typename ResultType>
+void DataPublisher<DataType, ResultType>::PublishDelta(
+    const DataType& sharedData,
+    const ShmDirtyRange* pDirtyRanges,
+    std::size_t numDirtyRanges)
+{
+    static_assert(std::is_trivially_copyable<DataType>::value,
+                  "Delta publishing requires a trivially copyable type");
+    static_assert(!ShmPayload<DataType, ResultType>::IsInPlace,
+                  "In-place results overwrite the previous request");
+
+    const unsigned char* pSource =
+        reinterpret_cast<const unsigned char*>(&sharedData);
+
+    /* Ranges given by the caller that do not lie within the data object
+     * fall back to a full copy */
+    bool validRanges = numDirtyRanges <= ShmMaxDirtyRanges;
+
+    for (std::size_t i = 0; validRanges && i < numDirtyRanges; ++i)
+        validRanges = pDirtyRanges[i].mOffset <= sizeof(DataType) &&
+                      pDirtyRanges[i].mLength <=
+                      sizeof(DataType) - pDirtyRanges[i].mOffset;
+
+    if (this->mpJournal != NULL)
+        this->mpJournal->AppendData(sharedData);
+
+    ShmMutexLock(&this->mpShared->mMutex);
+
+    /* Wait for subscriber to get ready */
+    while (this->mpShared->mState != ShmCommState::Init)
+        ShmCondWait(&this->mpShared->mCondSubscriberReady,
+                    &this->mpShared->mMutex);
+
+    /* Ranges are only valid if the segment still holds what this
+     * publisher wrote last */
+    bool fullCopy = !this->mpLastPublished || !validRanges ||
+                    this->mpShared->mDataGeneration !=
+                    this->mLastGeneration;
+
+    if (fullCopy) {
+        this->mpShared->mPayload.Data() = sharedData;
+        this->SetFullRange();
+    } else {
+        /* Copy modified regions only */
+        unsigned char* pShared = reinterpret_cast<unsigned char*>(
+            &this->mpShared->mPayload.Data());
+
+        for (std::size_t i = 0; i < numDirtyRanges; ++i) {
+            std::memcpy(pShared + pDirtyRanges[i].mOffset,
+                        pSource + pDirtyRanges[i].mOffset,
+                        pDirtyRanges[i].mLength);
+            this->mpShared->mDirtyRanges[i] = pDirtyRanges[i];
+        }
+
+        this->mpShared->mNumDirtyRanges = numDirtyRanges;
+        ++this->mpShared->mDataGeneration;
+    }
+
+    this->mLastGeneration = this->mpShared->mDataGeneration;
+    this->SetOwner();
+    this->mpShared->mState = ShmCommState::Published;
+
+    pthread_cond_signal(&this->mpShared->mCondPublisherReady);
+    pthread_cond_broadcast(&this->mpShared->mCondSubscriberReady);
+
+    pthread_mutex_unlock(&this->mpShared->mMutex);
+
+    /* Remember what the segment now holds */
+    if (!this->mpLastPublished) {
+        this->mpLastPublished.reset(new DataType(sharedData));
+    } else if (fullCopy) {
+        *this->mpLastPublished = sharedData;
+    } else {
+        unsigned char* pLast =
+            reinterpret_cast<unsigned char*>(this->mpLastPublished.get());
+
+        for (std::size_t i = 0; i < numDirtyRanges; ++i)
+            std::memcpy(pLast + pDirtyRanges[i].mOffset,
+                        pSource + pDirtyRanges[i].mOffset,
+                        pDirtyRanges[i].mLength);
+    }
+}
+
+template <typename DataType, typename ResultType>
+void DataPublisher<DataType, ResultType>::SetFullRange()
+{
+    /* Whole data object has been replaced */
+    this->mpShared->mNumDirtyRanges = 1;
+    this->mpShared->mDirtyRanges[0].mOffset = 0;
+    this->mpShared->mDirtyRanges[0].mLength = sizeof(DataType);
+    ++this->mpShared->mDataGeneration;
+}
+
+template <typename DataType, typename ResultType>
+void DataPublisher<DataType, ResultType>::SetOwner()
+{
+    /* New request is awaited only by this publisher so far */
+    this->mpShared->mWaiters = 1;
+    this->mpShared->mOwnerPid = this->mPid;
+    this->mpShared->mOwnerWaiters = 1;
+}
+
+template <typename DataType, typename ResultType>
+void DataPublisher<DataType, ResultType>::ReleaseWaiter()
+{
+    if (this->mpShared->mOwnerPid == this->mPid &&
+        this->mpShared->mOwnerWaiters > 0)
+        --this->mpShared->mOwnerWaiters;
+
+    /* Update the current state once every attached publisher has it */
+    if (--this->mpShared->mWaiters == 0) {
+        this->mpShared->mState = ShmCommState::GotResult;
+
+        /* Notify subscriber that publisher received result */
+        pthread_cond_signal(&this->mpShared->mCondGotResult);
+    }
+}
+
+template <typename DataType, typename ResultType>
+void DataPublisher<DataType, ResultType>::WaitForSubscribed()
+{
+    if constexpr (ShmPayload<DataType, ResultType>::IsStream) {
+        /* Partial results not read with NextPartial() are dropped, so that
+         * the subscriber does not block on a full ring */
+        while (this->mpShared->mState != ShmCommState::Subscribed) {
+            if (!this->mpShared->mPayload.RingEmpty()) {
+                this->mpShared->mPayload.mHead =
+                    this->mpShared->mPayload.mTail;
+                pthread_cond_broadcast(&this->mpShared->mCondStream);
+            }
+
+            ShmCondWait(&this->mpShared->mCondStream,
+                        &this->mpShared->mMutex);
+        }
+    } else {
+        while (this->mpShared->mState != ShmCommState::Subscribed)
+            ShmCondWait(&this->mpShared->mCondSubscribed,
+                        &this->mpShared->mMutex);
+    }
+}
+
 template <typename DataType, typename ResultType>
 void DataPublisher<DataType, ResultType>::WaitForResult()
 {
-    pthread_mutex_lock(&this->mpShared->mMutex);
+    /* Recorded results need a copy that the next request cannot change */
+    if (this->mpJournal != NULL && this->mpJournal->RecordsResults()) {
+        ResultValueType resultData;
+        this->WaitForResult(resultData);
+        return;
+    }
+
+    ShmMutexLock(&this->mpShared->mMutex);
 
     /* Wait for subscriber to process shared data */
-    while (this->mpShared->mState != ShmCommState::Subscribed)
-        pthread_cond_wait(&this->mpShared->mCondSubscribed,
-                          &this->mpShared->mMutex);
+    this->WaitForSubscribed();
 
-    /* Result returned by subscriber is stored in this->mpShared->mResult */
-    /* Update the current state */
-    this->mpShared->mState = ShmCommState::GotResult;
+    /* Result returned by subscriber is stored in this->mpShared->mPayload */
+    this->ReleaseWaiter();
 
-    /* Notify subscriber that publisher received result */
-    pthread_cond_signal(&this->mpShared->mCondGotResult);
+    pthread_mutex_unlock(&this->mpShared->mMutex);
+}
+
+template <typename DataType, typename ResultType>
+void DataPublisher<DataType, ResultType>::WaitForResult(
+    ResultValueType& resultData)
+{
+    ShmMutexLock(&this->mpShared->mMutex);
+
+    /* Wait for subscriber to process shared data */
+    this->WaitForSubscribed();
+
+    /* Copy result while it cannot be overwritten by the next request */
+    resultData = this->mpShared->mPayload.Result();
+
+    this->ReleaseWaiter();
+
+    pthread_mutex_unlock(&this->mpShared->mMutex);
+
+    /* Record result after releasing the lock */
+    if (this->mpJournal != NULL && this->mpJournal->RecordsResults())
+        this->mpJournal->AppendResult(resultData);
+}
+
+template <typename DataType, typename ResultType>
+bool DataPublisher<DataType, ResultType>::WaitForLiveResult()
+{
+    static_assert(!ShmPayload<DataType, ResultType>::IsStream,
+                  "Use ForEachPartial() to collect streamed results");
+
+    ShmMutexLock(&this->mpShared->mMutex);
+
+    /* Wait for subscriber to process shared data; a request that a dead
+     * subscriber never picked up or never answered is withdrawn, so that
+     * the caller can send it elsewhere */
+    while (this->mpShared->mState != ShmCommState::Subscribed) {
+        if (ShmProcessDead(this->mpShared->mSubscriberPid)) {
+            if (this->mpShared->mOwnerPid == this->mPid &&
+                this->mpShared->mOwnerWaiters > 0)
+                --this->mpShared->mOwnerWaiters;
+
+            if (this->mpShared->mWaiters > 0 &&
+                --this->mpShared->mWaiters == 0) {
+                this->mpShared->mState = ShmCommState::Init;
+                pthread_cond_broadcast(
+                    &this->mpShared->mCondSubscriberReady);
+            }
+
+            pthread_mutex_unlock(&this->mpShared->mMutex);
+            return false;
+        }
+
+        ShmCondTimedWait(&this->mpShared->mCondSubscribed,
+                         &this->mpShared->mMutex, ShmLivenessCheckMs);
+    }
+
+    /* Recorded results need a copy that the next request cannot change */
+    if (this->mpJournal != NULL && this->mpJournal->RecordsResults()) {
+        ResultValueType resultData = this->mpShared->mPayload.Result();
+        this->ReleaseWaiter();
+        pthread_mutex_unlock(&this->mpShared->mMutex);
+
+        /* Record result after releasing the lock */
+        this->mpJournal->AppendResult(resultData);
+        return true;
+    }
+
+    this->ReleaseWaiter();
+
+    pthread_mutex_unlock(&this->mpShared->mMutex);
+
+    return true;
+}
+
+template <typename DataType, typename ResultType>
+bool DataPublisher<DataType, ResultType>::NextPartial(
+    ResultValueType& partialData, bool& isFinal)
+{
+    static_assert(ShmPayload<DataType, ResultType>::IsStream,
+                  "Partial results require a StreamResult channel");
+
+    /* Results sent with SendFinal() go through the ring as well; the last
+     * one is returned here with isFinal set */
+    ShmMutexLock(&this->mpShared->mMutex);
+
+    /* Wait for subscriber to send the next partial result */
+    while (this->mpShared->mPayload.RingEmpty() &&
+           !this->mpShared->mPayload.mFinal)
+        ShmCondWait(&this->mpShared->mCondStream,
+                    &this->mpShared->mMutex);
+
+    /* Stream is complete, WaitForResult() finishes the request */
+    if (this->mpShared->mPayload.RingEmpty()) {
+        pthread_mutex_unlock(&this->mpShared->mMutex);
+        return false;
+    }
+
+    partialData = this->mpShared->mPayload.PopRing();
+
+    /* Final result is pushed last, together with setting mFinal */
+    isFinal = this->mpShared->mPayload.mFinal &&
+              this->mpShared->mPayload.RingEmpty();
+
+    /* Notify subscriber waiting for a free slot */
+    pthread_cond_broadcast(&this->mpShared->mCondStream);
 
     pthread_mutex_unlock(&this->mpShared->mMutex);
+
+    return true;
+}
+
+template <typename DataType, typename ResultType>
+template <typename PartialFn, typename FinalFn>
+void DataPublisher<DataType, ResultType>::ForEachPartial(
+    PartialFn partialCallback, FinalFn finalCallback)
+{
+    ResultValueType partialData;
+    bool isFinal;
+
+    while (this->NextPartial(partialData, isFinal)) {
+        if (isFinal)
+            finalCallback(partialData);
+        else
+            partialCallback(partialData);
+    }
+
+    this->WaitForResult();
 }
 
 template <typename DataType, typename ResultType>
 void DataPublisher<DataType, ResultType>::Stop()
 {
     /* Stop publisher */
-    pthread_mutex_lock(&this->mpShared->mMutex);
+    ShmMutexLock(&this->mpShared->mMutex);
     
     /* Publisher is now inactive */
     this->mpShared->mPublisherActive = false;
 
     pthread_cond_signal(&this->mpShared->mCondPublisherReady);
 
-    /* Wait for subscriber to stop */
-    while (this->mpShared->mSubscriberActive)
-        pthread_cond_wait(&this->mpShared->mCondSubscriberDone,
-                          &this->mpShared->mMutex);
+    /* Wait for subscriber to stop, unless it has died */
+    while (this->mpShared->mSubscriberActive) {
+        if (ShmProcessDead(this->mpShared->mSubscriberPid)) {
+            this->mpShared->mSubscriberActive = false;
+            break;
+        }
+
+        ShmCondTimedWait(&this->mpShared->mCondSubscriberDone,
+                         &this->mpShared->mMutex, ShmLivenessCheckMs);
+    }
 
     pthread_mutex_unlock(&this->mpShared->mMutex);
 }
@@ -285,17 +1258,42 @@ class DataSubscriber
 public:
     typedef SharedData<DataType, ResultType>  SharedType;
     typedef SharedData<DataType, ResultType>* SharedPtrType;
+    typedef typename ShmPayload<DataType, ResultType>::ResultValueType
+        ResultValueType;
+
+    /* Variable-sized arena follows the fixed layout on its own cache line */
+    static const std::size_t ArenaOffset =
+        (sizeof(SharedType) + 63) & ~static_cast<std::size_t>(63);
 
 public:
     DataSubscriber();
     ~DataSubscriber();
 
     bool Initialize(const char* sharedMemoryName);
+    bool Initialize(const char* sharedMemoryName,
+                    const ShmCommOptions& options);
     void Destroy();
     bool Subscribe();
-    void SendResult(ResultType& resultData);
-
-    inline DataType& GetData() const { return this->mpShared->mData; }
+    bool Remap();
+    void SendResult(ResultValueType& resultData);
+    void SendResult();
+    template <typename WriterFn>
+    void SendResultWith(WriterFn writer);
+    void SendPartial(const ResultValueType& partialData);
+    void SendFinal(const ResultValueType& finalData);
+
+    inline DataType& GetData() const
+    { return this->mpShared->mPayload.Data(); }
+    inline ResultValueType& GetResultBuffer() const
+    { return this->mpShared->mPayload.Result(); }
+    inline void* GetArena() const
+    { return reinterpret_cast<char*>(this->mpShared) + ArenaOffset; }
+    inline std::size_t GetArenaSize() const
+    { return this->mMappedSize > ArenaOffset ?
+             this->mMappedSize - ArenaOffset : 0; }
+    inline const ShmDirtyRange* GetDirtyRanges(std::size_t& numRanges) const
+    { numRanges = this->mpShared->mNumDirtyRanges;
+      return this->mpShared->mDirtyRanges; }
 
 private:
     DataSubscriber(const DataSubscriber& other);
@@ -307,6 +1305,7 @@ private:
     SharedPtrType mpShared;
     const char*   mShmName;
     int           mShmFd;
+    std::size_t   mMappedSize;
 };
 
 /*
@@ -317,7 +1316,8 @@ template <typename DataType, typename ResultType>
 DataSubscriber<DataType, ResultType>::DataSubscriber() :
     mpShared(NULL),
     mShmName(NULL),
-    mShmFd(-1)
+    mShmFd(-1),
+    mMappedSize(0)
 {
 }
 
@@ -330,6 +1330,13 @@ DataSubscriber<DataType, ResultType>::~DataSubscriber()
 template <typename DataType, typename ResultType>
 bool DataSubscriber<DataType, ResultType>::Initialize(
     const char* sharedMemoryName)
+{
+    return this->Initialize(sharedMemoryName, ShmCommOptions());
+}
+
+template <typename DataType, typename ResultType>
+bool DataSubscriber<DataType, ResultType>::Initialize(
+    const char* sharedMemoryName, const ShmCommOptions& options)
 {
     if (!sharedMemoryName) {
         std::cerr << "Invalid shared memory name" << std::endl;
@@ -338,9 +1345,10 @@ bool DataSubscriber<DataType, ResultType>::Initialize(
 
     this->mShmName = sharedMemoryName;
 
-    /* Open Posix shared memory object */
+    /* Open Posix shared memory object, creating it if the publisher has
+     * not started yet */
     this->mShmFd = shm_open(this->mShmName,
-                            O_RDWR,
+                            O_RDWR | O_CREAT,
                             S_IRUSR | S_IWUSR);
 
     if (this->mShmFd == -1) {
@@ -348,15 +1356,26 @@ bool DataSubscriber<DataType, ResultType>::Initialize(
         return false;
     }
 
-    /* Set the size of shared memory object */
-    if (ftruncate(this->mShmFd, sizeof(SharedType)) == -1) {
-        std::cerr << "Error: ftruncate() failed" << std::endl;
+    struct stat shmStat;
+
+    if (fstat(this->mShmFd, &shmStat) == -1) {
+        std::cerr << "Error: fstat() failed" << std::endl;
+        this->Destroy();
+        return false;
+    }
+
+    std::size_t shmSize = shmStat.st_size;
+    std::size_t mappedSize = shmSize == 0 ? sizeof(SharedType) : shmSize;
+
+    if (shmSize != 0 && shmSize < sizeof(SharedType)) {
+        std::cerr << "Error: shared memory size mismatch" << std::endl;
+        this->Destroy();
         return false;
     }
 
     /* Map shared memory object to memory */
     void* pShared = mmap(NULL,
-                         sizeof(SharedType),
+                         mappedSize,
                          PROT_READ | PROT_WRITE,
                          MAP_SHARED,
                          this->mShmFd,
@@ -364,11 +1383,80 @@ bool DataSubscriber<DataType, ResultType>::Initialize(
 
     if (pShared == MAP_FAILED) {
         std::cerr << "Error: mmap() failed" << std::endl;
+        this->Destroy();
         return false;
     }
 
     /* Set the pointer to shared memory */
     this->mpShared = reinterpret_cast<SharedPtrType>(pShared);
+    this->mMappedSize = mappedSize;
+
+    /* Bind shared memory to NUMA node before this process allocates or
+     * touches any page; a subscriber that starts first faults in the
+     * header, state and mutex, so it must be given the node of the
+     * publisher, as pages mapped elsewhere are not migrated later */
+    if (options.mNumaNode >= 0 &&
+        !ShmBindToNode(pShared, mappedSize, options.mNumaNode)) {
+        this->Destroy();
+        return false;
+    }
+
+    /* Only size an empty object; posix_fallocate() never shrinks it, so
+     * a publisher sizing it at the same time cannot lose its arena */
+    if (shmSize == 0 &&
+        posix_fallocate(this->mShmFd, 0, sizeof(SharedType)) != 0) {
+        std::cerr << "Error: posix_fallocate() failed" << std::endl;
+        this->Destroy();
+        return false;
+    }
+
+    /* Wait for publisher to initialize the segment */
+    ShmSegmentHeader& header = this->mpShared->mHeader;
+
+    while (__atomic_load_n(&header.mInitialized, __ATOMIC_ACQUIRE) == 0)
+        ShmFutexWait(&header.mInitialized, 0);
+
+    if (header.mMagic != ShmSegmentMagic ||
+        header.mVersion != ShmSegmentVersion ||
+        header.mLayoutHash !=
+        ShmLayoutHash<SharedType, DataType, ResultType>()) {
+        std::cerr << "Error: shared memory layout mismatch" << std::endl;
+        this->Destroy();
+        return false;
+    }
+
+    /* Publisher may have created the segment larger than mapped here */
+    if (!this->Remap()) {
+        this->Destroy();
+        return false;
+    }
+
+    ShmMutexLock(&this->mpShared->mMutex);
+
+    this->mpShared->mSubscriberActive = true;
+    this->mpShared->mSubscriberPid = getpid();
+
+    /* A previous subscriber may have died after sending its result; let
+     * the publisher collect it and hand the channel back */
+    while (this->mpShared->mState == ShmCommState::Subscribed)
+        ShmCondWait(&this->mpShared->mCondGotResult,
+                    &this->mpShared->mMutex);
+
+    if (this->mpShared->mState == ShmCommState::GotResult) {
+        if constexpr (ShmPayload<DataType, ResultType>::IsStream)
+            this->mpShared->mPayload.ResetRing();
+
+        this->mpShared->mState = ShmCommState::Init;
+        pthread_cond_broadcast(&this->mpShared->mCondSubscriberReady);
+    }
+
+    pthread_mutex_unlock(&this->mpShared->mMutex);
+
+    /* Notify publisher waiting for a subscriber */
+    ShmSegmentHeader& attachedHeader = this->mpShared->mHeader;
+    __atomic_fetch_add(&attachedHeader.mSubscriberAttached, 1,
+                       __ATOMIC_RELEASE);
+    ShmFutexWake(&attachedHeader.mSubscriberAttached);
 
     return true;
 }
@@ -378,39 +1466,69 @@ void DataSubscriber<DataType, ResultType>::Destroy()
 {
     /* Unmap shared memory */
     if (this->mpShared != NULL)
-        munmap(this->mpShared, sizeof(SharedType));
+        munmap(this->mpShared, this->mMappedSize);
 
-    /* Close Posix shared memory object */
+    /* Close Posix shared memory object, which is left to the publisher
+     * so that a restarted subscriber can attach to it again */
     if (this->mShmFd != -1)
         close(this->mShmFd);
 
-    /* Unlink Posix shared memory object */
-    if (this->mShmName != NULL)
-        shm_unlink(this->mShmName);
-
     this->mpShared = NULL;
     this->mShmName = NULL;
     this->mShmFd = -1;
+    this->mMappedSize = 0;
+}
+
+template <typename DataType, typename ResultType>
+bool DataSubscriber<DataType, ResultType>::Remap()
+{
+    /* Must be called without holding the mutex, which moves along with
+     * the mapping */
+    std::size_t segmentSize = __atomic_load_n(
+        &this->mpShared->mHeader.mSegmentSize, __ATOMIC_ACQUIRE);
+
+    if (segmentSize <= this->mMappedSize)
+        return true;
+
+    void* pShared = mremap(this->mpShared, this->mMappedSize,
+                           segmentSize, MREMAP_MAYMOVE);
+
+    if (pShared == MAP_FAILED) {
+        std::cerr << "Error: mremap() failed" << std::endl;
+        return false;
+    }
+
+    this->mpShared = reinterpret_cast<SharedPtrType>(pShared);
+    this->mMappedSize = segmentSize;
+
+    return true;
 }
 
 template <typename DataType, typename ResultType>
 bool DataSubscriber<DataType, ResultType>::Subscribe()
 {
-    pthread_mutex_lock(&this->mpShared->mMutex);
+    ShmMutexLock(&this->mpShared->mMutex);
 
     /* Wait for publisher to get ready */
     while (this->mpShared->mState != ShmCommState::Published &&
            this->mpShared->mPublisherActive)
-        pthread_cond_wait(&this->mpShared->mCondPublisherReady,
-                          &this->mpShared->mMutex);
+        ShmCondWait(&this->mpShared->mCondPublisherReady,
+                    &this->mpShared->mMutex);
 
     if (this->mpShared->mState == ShmCommState::Published) {
-        /* Data object from publisher is stored in this->mpShared->mData */
+        /* Data object from publisher is stored in this->mpShared->mPayload */
         pthread_mutex_unlock(&this->mpShared->mMutex);
-        return true;
+
+        /* Publisher grows the segment before publishing data that uses
+         * the new space, so remapping here is enough to reach it */
+        if (this->Remap())
+            return true;
+
+        /* Request cannot be served without reaching the new space */
+        ShmMutexLock(&this->mpShared->mMutex);
     }
 
-    /* Exit if publisher is not active anymore */
+    /* Exit if publisher is not active anymore or remapping failed */
     this->mpShared->mSubscriberActive = false;
 
     /* Notify publisher that subscriber is now inactive */
@@ -422,34 +1540,148 @@ bool DataSubscriber<DataType, ResultType>::Subscribe()
 }
 
 template <typename DataType, typename ResultType>
-void DataSubscriber<DataType, ResultType>::SendResult(ResultType& resultData)
+void DataSubscriber<DataType, ResultType>::SendResult(
+    ResultValueType& resultData)
+{
+    /* Pass result to publisher */
+    this->SendResultWith([&resultData](ResultValueType& sharedResult) {
+        sharedResult = resultData;
+    });
+}
+
+template <typename DataType, typename ResultType>
+void DataSubscriber<DataType, ResultType>::SendResult()
 {
-    pthread_mutex_lock(&this->mpShared->mMutex);
+    /* Result has already been written through GetResultBuffer(), e.g.
+     * by transforming the request in place */
+    this->SendResultWith([](ResultValueType&) { });
+}
+
+template <typename DataType, typename ResultType>
+template <typename WriterFn>
+void DataSubscriber<DataType, ResultType>::SendResultWith(WriterFn writer)
+{
+    static_assert(!ShmPayload<DataType, ResultType>::IsStream,
+                  "Use SendPartial() and SendFinal() to stream results");
+
+    ShmMutexLock(&this->mpShared->mMutex);
 
     if (this->mpShared->mState != ShmCommState::Published) {
         pthread_mutex_unlock(&this->mpShared->mMutex);
         return;
     }
         
-    /* Pass result to publisher */
-    this->mpShared->mResult = resultData;
+    /* Let caller write result directly into shared memory; the writer
+     * runs under the channel lock and should only copy the result, longer
+     * work writes through GetResultBuffer() before calling SendResult() */
+    writer(this->mpShared->mPayload.Result());
 
     /* Update the current state */
     this->mpShared->mState = ShmCommState::Subscribed;
 
-    /* Notify publisher that subscriber received data object */
-    pthread_cond_signal(&this->mpShared->mCondSubscribed);
+    /* Notify every publisher waiting for this request */
+    pthread_cond_broadcast(&this->mpShared->mCondSubscribed);
+
+    /* Request has been abandoned by a publisher that died */
+    if (this->mpShared->mWaiters == 0)
+        this->mpShared->mState = ShmCommState::GotResult;
     
     /* Wait for publisher to check result */
     while (this->mpShared->mState != ShmCommState::GotResult)
-        pthread_cond_wait(&this->mpShared->mCondGotResult,
-                          &this->mpShared->mMutex);
+        ShmCondWait(&this->mpShared->mCondGotResult,
+                    &this->mpShared->mMutex);
     
     /* Update the current state */
     this->mpShared->mState = ShmCommState::Init;
 
-    /* Notify publisher that subscriber is ready */
-    pthread_cond_signal(&this->mpShared->mCondSubscriberReady);
+    /* Notify queued publishers that subscriber is ready */
+    pthread_cond_broadcast(&this->mpShared->mCondSubscriberReady);
+
+    pthread_mutex_unlock(&this->mpShared->mMutex);
+}
+
+template <typename DataType, typename ResultType>
+void DataSubscriber<DataType, ResultType>::SendPartial(
+    const ResultValueType& partialData)
+{
+    static_assert(ShmPayload<DataType, ResultType>::IsStream,
+                  "Partial results require a StreamResult channel");
+
+    ShmMutexLock(&this->mpShared->mMutex);
+
+    if (this->mpShared->mState != ShmCommState::Published) {
+        pthread_mutex_unlock(&this->mpShared->mMutex);
+        return;
+    }
+
+    /* Wait for publisher to consume a partial result if ring is full,
+     * or drop the oldest one if the publisher died */
+    while (this->mpShared->mPayload.RingFull()) {
+        if (this->mpShared->mWaiters == 0) {
+            this->mpShared->mPayload.PopRing();
+            break;
+        }
+
+        ShmCondWait(&this->mpShared->mCondStream,
+                    &this->mpShared->mMutex);
+    }
+
+    /* Pass partial result to publisher without waiting for it */
+    this->mpShared->mPayload.PushRing(partialData);
+    pthread_cond_broadcast(&this->mpShared->mCondStream);
+
+    pthread_mutex_unlock(&this->mpShared->mMutex);
+}
+
+template <typename DataType, typename ResultType>
+void DataSubscriber<DataType, ResultType>::SendFinal(
+    const ResultValueType& finalData)
+{
+    static_assert(ShmPayload<DataType, ResultType>::IsStream,
+                  "Partial results require a StreamResult channel");
+
+    ShmMutexLock(&this->mpShared->mMutex);
+
+    if (this->mpShared->mState != ShmCommState::Published) {
+        pthread_mutex_unlock(&this->mpShared->mMutex);
+        return;
+    }
+
+    while (this->mpShared->mPayload.RingFull()) {
+        if (this->mpShared->mWaiters == 0) {
+            this->mpShared->mPayload.PopRing();
+            break;
+        }
+
+        ShmCondWait(&this->mpShared->mCondStream,
+                    &this->mpShared->mMutex);
+    }
+
+    /* Pass last result and close the stream */
+    this->mpShared->mPayload.PushRing(finalData);
+    this->mpShared->mPayload.mFinal = true;
+
+    /* Update the current state */
+    this->mpShared->mState = ShmCommState::Subscribed;
+
+    pthread_cond_broadcast(&this->mpShared->mCondStream);
+    pthread_cond_broadcast(&this->mpShared->mCondSubscribed);
+
+    /* Request has been abandoned by a publisher that died */
+    if (this->mpShared->mWaiters == 0)
+        this->mpShared->mState = ShmCommState::GotResult;
+
+    /* Wait for publisher to drain the stream and check result */
+    while (this->mpShared->mState != ShmCommState::GotResult)
+        ShmCondWait(&this->mpShared->mCondGotResult,
+                    &this->mpShared->mMutex);
+
+    /* Update the current state */
+    this->mpShared->mPayload.ResetRing();
+    this->mpShared->mState = ShmCommState::Init;
+
+    /* Notify queued publishers that subscriber is ready */
+    pthread_cond_broadcast(&this->mpShared->mCondSubscriberReady);
 
     pthread_mutex_unlock(&this->mpShared->mMutex);
 }
@@ -0,0 +1,423 @@
+
+/* shm_journal.h */
+
+#ifndef SHM_JOURNAL_H
+#define SHM_JOURNAL_H
+
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/*
+ * Journal file layout
+ *
+ * +----------------------+
+ * | ShmJournalHeader     |
+ * +----------------------+
+ * | index (mCapacity x   |  offset of each record, 0 while the record is
+ * |   std::uint64_t)     |  still being written
+ * +----------------------+
+ * | records              |  ShmJournalRecord followed by the payload,
+ * |                      |  padded to 8 bytes
+ * +----------------------+
+ *
+ * The file is sized once when it is created. Writers reserve an index
+ * slot and the record space with atomic additions and publish the record
+ * by storing its offset, so recording never takes a lock.
+ */
+
+static const std::uint64_t ShmJournalMagic   = 0x4c4e524a4d4853ULL;
+static const std::uint32_t ShmJournalVersion = 1;
+
+enum ShmJournalRecordKind
+{
+    DataRecord   = 0,
+    ResultRecord = 1,
+};
+
+struct ShmJournalHeader
+{
+    std::uint64_t mMagic;
+    std::uint32_t mVersion;
+    std::uint32_t mRecordsResults;
+    std::uint32_t mDataSize;
+    std::uint32_t mResultSize;
+    std::uint64_t mCapacity;
+    std::uint64_t mIndexOffset;
+    std::uint64_t mRecordOffset;
+    std::uint64_t mFileSize;
+    std::uint64_t mNumReserved;
+    std::uint64_t mRecordTail;
+};
+
+struct ShmJournalRecord
+{
+    std::uint64_t mTimestamp;
+    std::uint32_t mKind;
+    std::uint32_t mSize;
+};
+
+inline std::uint64_t ShmJournalTimestamp()
+{
+    /* CLOCK_MONOTONIC is served from the vDSO without a system call */
+    struct timespec timeSpec;
+    clock_gettime(CLOCK_MONOTONIC, &timeSpec);
+
+    return static_cast<std::uint64_t>(timeSpec.tv_sec) * 1000000000ULL +
+           static_cast<std::uint64_t>(timeSpec.tv_nsec);
+}
+
+inline std::uint64_t ShmJournalRecordSize(std::uint64_t payloadSize)
+{
+    return (sizeof(ShmJournalRecord) + payloadSize + 7) & ~7ULL;
+}
+
+/*
+ * MessageJournal class definitions
+ */
+
+template <typename DataType, typename ResultType>
+class MessageJournal
+{
+public:
+    MessageJournal();
+    ~MessageJournal();
+
+    bool Create(const char* fileName,
+                std::uint64_t capacity,
+                bool recordResults);
+    void Close();
+    void AppendData(const DataType& data);
+    void AppendResult(const ResultType& result);
+
+    inline bool RecordsResults() const
+    { return this->mpHeader->mRecordsResults != 0; }
+    inline std::uint64_t NumDropped() const { return this->mNumDropped; }
+
+private:
+    MessageJournal(const MessageJournal& other);
+    MessageJournal(MessageJournal&& other);
+    MessageJournal& operator=(const MessageJournal& other);
+    MessageJournal& operator=(MessageJournal&& other);
+
+    void Append(ShmJournalRecordKind kind,
+                const void* pPayload,
+                std::uint32_t payloadSize);
+
+private:
+    ShmJournalHeader* mpHeader;
+    std::uint64_t*    mpIndex;
+    char*             mpFile;
+    int               mFd;
+    std::uint64_t     mNumDropped;
+};
+
+/*
+ * MessageJournal class methods
+ */
+
+template <typename DataType, typename ResultType>
+MessageJournal<DataType, ResultType>::MessageJournal() :
+    mpHeader(NULL),
+    mpIndex(NULL),
+    mpFile(NULL),
+    mFd(-1),
+    mNumDropped(0)
+{
+    static_assert(std::is_trivially_copyable<DataType>::value &&
+                  std::is_trivially_copyable<ResultType>::value,
+                  "Journaled types must be trivially copyable");
+}
+
+template <typename DataType, typename ResultType>
+MessageJournal<DataType, ResultType>::~MessageJournal()
+{
+    this->Close();
+}
+
+template <typename DataType, typename ResultType>
+bool MessageJournal<DataType, ResultType>::Create(
+    const char* fileName, std::uint64_t capacity, bool recordResults)
+{
+    if (!fileName || capacity == 0) {
+        std::cerr << "Invalid journal file name or capacity" << std::endl;
+        return false;
+    }
+
+    /* Size the record area for the larger of the two payloads */
+    std::uint64_t indexOffset = (sizeof(ShmJournalHeader) + 63) & ~63ULL;
+    std::uint64_t recordOffset = indexOffset +
+                                 capacity * sizeof(std::uint64_t);
+    std::uint64_t recordSize = ShmJournalRecordSize(
+        sizeof(DataType) > sizeof(ResultType) ?
+        sizeof(DataType) : sizeof(ResultType));
+    std::uint64_t fileSize = recordOffset + capacity * recordSize;
+
+    this->mFd = open(fileName, O_RDWR | O_CREAT | O_TRUNC,
+                     S_IRUSR | S_IWUSR);
+
+    if (this->mFd == -1) {
+        std::cerr << "Error: open() failed" << std::endl;
+        return false;
+    }
+
+    /* Allocate the blocks now rather than on the Publish() path */
+    if (posix_fallocate(this->mFd, 0, fileSize) != 0) {
+        std::cerr << "Error: posix_fallocate() failed" << std::endl;
+        this->Close();
+        return false;
+    }
+
+    void* pFile = mmap(NULL, fileSize, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, this->mFd, 0);
+
+    if (pFile == MAP_FAILED) {
+        std::cerr << "Error: mmap() failed" << std::endl;
+        this->Close();
+        return false;
+    }
+
+    /* Records are written once, front to back */
+    madvise(pFile, fileSize, MADV_SEQUENTIAL);
+
+    /* MAP_POPULATE only maps shared pages read-only; writing each page
+     * once takes the write faults here instead of in Append() */
+    const std::uint64_t pageSize = sysconf(_SC_PAGESIZE);
+
+    for (std::uint64_t offset = 0; offset < fileSize; offset += pageSize)
+        static_cast<volatile char*>(pFile)[offset] = 0;
+
+    this->mpFile = static_cast<char*>(pFile);
+    this->mpHeader = reinterpret_cast<ShmJournalHeader*>(this->mpFile);
+    this->mpIndex = reinterpret_cast<std::uint64_t*>(
+        this->mpFile + indexOffset);
+
+    this->mpHeader->mMagic = ShmJournalMagic;
+    this->mpHeader->mVersion = ShmJournalVersion;
+    this->mpHeader->mRecordsResults = recordResults ? 1 : 0;
+    this->mpHeader->mDataSize = sizeof(DataType);
+    this->mpHeader->mResultSize = sizeof(ResultType);
+    this->mpHeader->mCapacity = capacity;
+    this->mpHeader->mIndexOffset = indexOffset;
+    this->mpHeader->mRecordOffset = recordOffset;
+    this->mpHeader->mFileSize = fileSize;
+    this->mpHeader->mNumReserved = 0;
+    this->mpHeader->mRecordTail = recordOffset;
+
+    return true;
+}
+
+template <typename DataType, typename ResultType>
+void MessageJournal<DataType, ResultType>::Close()
+{
+    /* Unmap journal file, the kernel writes back dirty pages */
+    if (this->mpFile != NULL)
+        munmap(this->mpFile, this->mpHeader->mFileSize);
+
+    if (this->mFd != -1)
+        close(this->mFd);
+
+    this->mpHeader = NULL;
+    this->mpIndex = NULL;
+    this->mpFile = NULL;
+    this->mFd = -1;
+}
+
+template <typename DataType, typename ResultType>
+void MessageJournal<DataType, ResultType>::AppendData(const DataType& data)
+{
+    this->Append(ShmJournalRecordKind::DataRecord, &data, sizeof(DataType));
+}
+
+template <typename DataType, typename ResultType>
+void MessageJournal<DataType, ResultType>::AppendResult(
+    const ResultType& result)
+{
+    this->Append(ShmJournalRecordKind::ResultRecord,
+                 &result, sizeof(ResultType));
+}
+
+template <typename DataType, typename ResultType>
+void MessageJournal<DataType, ResultType>::Append(
+    ShmJournalRecordKind kind, const void* pPayload, std::uint32_t payloadSize)
+{
+    std::uint64_t timestamp = ShmJournalTimestamp();
+    std::uint64_t recordSize = ShmJournalRecordSize(payloadSize);
+
+    /* Reserve index slot and record space */
+    std::uint64_t slot = __atomic_fetch_add(
+        &this->mpHeader->mNumReserved, 1, __ATOMIC_RELAXED);
+
+    if (slot >= this->mpHeader->mCapacity) {
+        __atomic_fetch_add(&this->mNumDropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    std::uint64_t offset = __atomic_fetch_add(
+        &this->mpHeader->mRecordTail, recordSize, __ATOMIC_RELAXED);
+
+    ShmJournalRecord* pRecord =
+        reinterpret_cast<ShmJournalRecord*>(this->mpFile + offset);
+    pRecord->mTimestamp = timestamp;
+    pRecord->mKind = kind;
+    pRecord->mSize = payloadSize;
+    std::memcpy(pRecord + 1, pPayload, payloadSize);
+
+    /* Record becomes visible to readers once its offset is stored */
+    __atomic_store_n(&this->mpIndex[slot], offset, __ATOMIC_RELEASE);
+}
+
+/*
+ * JournalReader class definitions
+ */
+
+template <typename DataType, typename ResultType>
+class JournalReader
+{
+public:
+    JournalReader();
+    ~JournalReader();
+
+    bool Open(const char* fileName);
+    void Close();
+    std::uint64_t NumRecords() const;
+
+    inline const ShmJournalRecord& GetRecord(std::uint64_t i) const
+    { return *reinterpret_cast<const ShmJournalRecord*>(
+        this->mpFile + this->mpIndex[i]); }
+    inline const DataType& GetData(std::uint64_t i) const
+    { return *reinterpret_cast<const DataType*>(&this->GetRecord(i) + 1); }
+    inline const ResultType& GetResult(std::uint64_t i) const
+    { return *reinterpret_cast<const ResultType*>(&this->GetRecord(i) + 1); }
+
+private:
+    JournalReader(const JournalReader& other);
+    JournalReader(JournalReader&& other);
+    JournalReader& operator=(const JournalReader& other);
+    JournalReader& operator=(JournalReader&& other);
+
+private:
+    const ShmJournalHeader* mpHeader;
+    const std::uint64_t*    mpIndex;
+    const char*             mpFile;
+    std::uint64_t           mFileSize;
+    int                     mFd;
+};
+
+/*
+ * JournalReader class methods
+ */
+
+template <typename DataType, typename ResultType>
+JournalReader<DataType, ResultType>::JournalReader() :
+    mpHeader(NULL),
+    mpIndex(NULL),
+    mpFile(NULL),
+    mFileSize(0),
+    mFd(-1)
+{
+}
+
+template <typename DataType, typename ResultType>
+JournalReader<DataType, ResultType>::~JournalReader()
+{
+    this->Close();
+}
+
+template <typename DataType, typename ResultType>
+bool JournalReader<DataType, ResultType>::Open(const char* fileName)
+{
+    if (!fileName) {
+        std::cerr << "Invalid journal file name" << std::endl;
+        return false;
+    }
+
+    this->mFd = open(fileName, O_RDONLY);
+
+    if (this->mFd == -1) {
+        std::cerr << "Error: open() failed" << std::endl;
+        return false;
+    }
+
+    struct stat fileStat;
+
+    if (fstat(this->mFd, &fileStat) == -1 ||
+        static_cast<std::uint64_t>(fileStat.st_size) <
+        sizeof(ShmJournalHeader)) {
+        std::cerr << "Error: invalid journal file" << std::endl;
+        this->Close();
+        return false;
+    }
+
+    void* pFile = mmap(NULL, fileStat.st_size, PROT_READ,
+                       MAP_SHARED, this->mFd, 0);
+
+    if (pFile == MAP_FAILED) {
+        std::cerr << "Error: mmap() failed" << std::endl;
+        this->Close();
+        return false;
+    }
+
+    this->mpFile = static_cast<const char*>(pFile);
+    this->mFileSize = fileStat.st_size;
+    this->mpHeader = reinterpret_cast<const ShmJournalHeader*>(pFile);
+
+    if (this->mpHeader->mMagic != ShmJournalMagic ||
+        this->mpHeader->mVersion != ShmJournalVersion ||
+        this->mpHeader->mFileSize != this->mFileSize ||
+        this->mpHeader->mDataSize != sizeof(DataType) ||
+        this->mpHeader->mResultSize != sizeof(ResultType)) {
+        std::cerr << "Error: journal does not match message types"
+                  << std::endl;
+        this->Close();
+        return false;
+    }
+
+    this->mpIndex = reinterpret_cast<const std::uint64_t*>(
+        this->mpFile + this->mpHeader->mIndexOffset);
+
+    return true;
+}
+
+template <typename DataType, typename ResultType>
+void JournalReader<DataType, ResultType>::Close()
+{
+    if (this->mpFile != NULL)
+        munmap(const_cast<char*>(this->mpFile), this->mFileSize);
+
+    if (this->mFd != -1)
+        close(this->mFd);
+
+    this->mpHeader = NULL;
+    this->mpIndex = NULL;
+    this->mpFile = NULL;
+    this->mFileSize = 0;
+    this->mFd = -1;
+}
+
+template <typename DataType, typename ResultType>
+std::uint64_t JournalReader<DataType, ResultType>::NumRecords() const
+{
+    std::uint64_t numReserved = __atomic_load_n(
+        &this->mpHeader->mNumReserved, __ATOMIC_ACQUIRE);
+
+    if (numReserved > this->mpHeader->mCapacity)
+        numReserved = this->mpHeader->mCapacity;
+
+    /* Stop at the first record that has not been completely written */
+    for (std::uint64_t i = 0; i < numReserved; ++i)
+        if (__atomic_load_n(&this->mpIndex[i], __ATOMIC_ACQUIRE) == 0)
+            return i;
+
+    return numReserved;
+}
+
+#endif /* SHM_JOURNAL_H */
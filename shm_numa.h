@@ -0,0 +1,285 @@
+
+/* shm_numa.h */
+
+#ifndef SHM_NUMA_H
+#define SHM_NUMA_H
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+
+/*
+ * ShmPlacement enum definitions
+ *
+ * Relative placement of the publisher and subscriber threads, from the
+ * closest (two hardware threads of one core) to the farthest
+ */
+
+enum ShmPlacement
+{
+    SameCore  = 0,
+    SameCache = 1,
+    SameNode  = 2,
+    CrossNode = 3,
+};
+
+/*
+ * ShmCpuInfo struct definitions
+ */
+
+struct ShmCpuInfo
+{
+    int mCpu;
+    int mCore;
+    int mPackage;
+    int mCache;
+    int mNode;
+};
+
+/*
+ * Topology helper functions
+ */
+
+inline bool ShmReadSysfsValue(const std::string& path, std::string& value)
+{
+    FILE* pFile = std::fopen(path.c_str(), "r");
+
+    if (pFile == NULL)
+        return false;
+
+    char buffer[256];
+    bool succeeded = std::fgets(buffer, sizeof(buffer), pFile) != NULL;
+    std::fclose(pFile);
+
+    if (!succeeded)
+        return false;
+
+    value = buffer;
+
+    while (!value.empty() && (value.back() == '\n' || value.back() == ' '))
+        value.pop_back();
+
+    return true;
+}
+
+inline int ShmReadSysfsInt(const std::string& path, int defaultValue)
+{
+    std::string value;
+
+    if (!ShmReadSysfsValue(path, value) || value.empty())
+        return defaultValue;
+
+    return std::atoi(value.c_str());
+}
+
+/* Parse a kernel cpu list such as "0-3,8,10-11" */
+inline std::vector<int> ShmParseCpuList(const std::string& cpuList)
+{
+    std::vector<int> cpus;
+    std::size_t pos = 0;
+
+    while (pos < cpuList.size()) {
+        std::size_t end = cpuList.find(',', pos);
+
+        if (end == std::string::npos)
+            end = cpuList.size();
+
+        std::string range = cpuList.substr(pos, end - pos);
+        std::size_t dash = range.find('-');
+
+        if (!range.empty()) {
+            int first = std::atoi(range.c_str());
+            int last = dash == std::string::npos ?
+                       first : std::atoi(range.c_str() + dash + 1);
+
+            for (int cpu = first; cpu <= last; ++cpu)
+                cpus.push_back(cpu);
+        }
+
+        pos = end + 1;
+    }
+
+    return cpus;
+}
+
+inline bool ShmQueryTopology(std::vector<ShmCpuInfo>& cpuInfos)
+{
+    const std::string sysCpu = "/sys/devices/system/cpu/";
+    const std::string sysNode = "/sys/devices/system/node/";
+    std::string onlineList;
+
+    cpuInfos.clear();
+
+    if (!ShmReadSysfsValue(sysCpu + "online", onlineList)) {
+        std::cerr << "Error: failed to read online cpus" << std::endl;
+        return false;
+    }
+
+    for (int cpu : ShmParseCpuList(onlineList)) {
+        std::string cpuDir = sysCpu + "cpu" + std::to_string(cpu) + "/";
+        std::string sharedList;
+        ShmCpuInfo cpuInfo;
+
+        cpuInfo.mCpu = cpu;
+        cpuInfo.mCore = ShmReadSysfsInt(
+            cpuDir + "topology/core_id", cpu);
+        cpuInfo.mPackage = ShmReadSysfsInt(
+            cpuDir + "topology/physical_package_id", 0);
+
+        /* Identify the last level cache by its lowest sharing cpu */
+        if (ShmReadSysfsValue(cpuDir + "cache/index3/shared_cpu_list",
+                              sharedList))
+            cpuInfo.mCache = ShmParseCpuList(sharedList).front();
+        else
+            cpuInfo.mCache = -1;
+
+        /* Node stays unknown (and nothing is bound) without NUMA */
+        cpuInfo.mNode = -1;
+        cpuInfos.push_back(cpuInfo);
+    }
+
+    /* Assign nodes from the node cpu lists (absent without NUMA) */
+    std::string nodeList;
+
+    if (ShmReadSysfsValue(sysNode + "online", nodeList)) {
+        for (int node : ShmParseCpuList(nodeList)) {
+            std::string cpuList;
+
+            if (!ShmReadSysfsValue(sysNode + "node" +
+                                   std::to_string(node) + "/cpulist",
+                                   cpuList))
+                continue;
+
+            for (int cpu : ShmParseCpuList(cpuList))
+                for (ShmCpuInfo& cpuInfo : cpuInfos)
+                    if (cpuInfo.mCpu == cpu)
+                        cpuInfo.mNode = node;
+        }
+    }
+
+    return !cpuInfos.empty();
+}
+
+inline bool ShmMatchesPlacement(const ShmCpuInfo& first,
+                                const ShmCpuInfo& second,
+                                ShmPlacement placement)
+{
+    bool sameCore = first.mPackage == second.mPackage &&
+                    first.mCore == second.mCore;
+    bool sameCache = first.mCache != -1 && second.mCache != -1 &&
+                     first.mCache == second.mCache;
+    bool sameNode = first.mNode == second.mNode;
+    bool crossNode = first.mNode != -1 && second.mNode != -1 && !sameNode;
+
+    switch (placement) {
+        case ShmPlacement::SameCore:
+            return sameCore;
+        case ShmPlacement::SameCache:
+            return !sameCore && sameCache;
+        case ShmPlacement::SameNode:
+            return !sameCore && !sameCache && sameNode;
+        case ShmPlacement::CrossNode:
+            return crossNode;
+    }
+
+    return false;
+}
+
+/* Find two distinct cpus with the given placement and their node
+ * (the node of the publisher cpu, to which the segment should be bound,
+ * or -1 if the kernel does not report nodes) */
+inline bool ShmFindCpuPair(ShmPlacement placement,
+                           int& publisherCpu,
+                           int& subscriberCpu,
+                           int& numaNode)
+{
+    std::vector<ShmCpuInfo> cpuInfos;
+
+    if (!ShmQueryTopology(cpuInfos))
+        return false;
+
+    for (const ShmCpuInfo& first : cpuInfos) {
+        for (const ShmCpuInfo& second : cpuInfos) {
+            if (first.mCpu == second.mCpu ||
+                !ShmMatchesPlacement(first, second, placement))
+                continue;
+
+            publisherCpu = first.mCpu;
+            subscriberCpu = second.mCpu;
+            numaNode = first.mNode;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Suggest the pairing with the lowest round-trip latency: separate cores
+ * sharing the last level cache, then hardware threads of one core, then
+ * cores of one node, then anything */
+inline bool ShmSuggestCpuPair(int& publisherCpu,
+                              int& subscriberCpu,
+                              int& numaNode)
+{
+    const ShmPlacement preferences[] = {
+        ShmPlacement::SameCache,
+        ShmPlacement::SameCore,
+        ShmPlacement::SameNode,
+        ShmPlacement::CrossNode,
+    };
+
+    for (ShmPlacement placement : preferences)
+        if (ShmFindCpuPair(placement, publisherCpu, subscriberCpu, numaNode))
+            return true;
+
+    return false;
+}
+
+/*
+ * Affinity and memory policy functions
+ */
+
+/* Pin the calling thread to the given cpu */
+inline bool ShmPinThread(int cpu)
+{
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpu, &cpuSet);
+
+    if (pthread_setaffinity_np(pthread_self(),
+                               sizeof(cpuSet), &cpuSet) != 0) {
+        std::cerr << "Error: pthread_setaffinity_np() failed" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+/* Bind the pages of a mapping to the given NUMA node; pages already
+ * faulted in by this process are migrated */
+inline bool ShmBindToNode(void* pAddress, std::size_t length, int numaNode)
+{
+    const std::size_t bitsPerLong = sizeof(unsigned long) * 8;
+    std::vector<unsigned long> nodeMask(numaNode / bitsPerLong + 1, 0);
+    nodeMask[numaNode / bitsPerLong] |= 1UL << (numaNode % bitsPerLong);
+
+    if (syscall(SYS_mbind, pAddress, length, MPOL_BIND,
+                nodeMask.data(), nodeMask.size() * bitsPerLong + 1,
+                MPOL_MF_MOVE) == -1) {
+        std::cerr << "Error: mbind() failed: errno " << errno << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+#endif /* SHM_NUMA_H */
@@ -0,0 +1,138 @@
+
+/* shm_replay.h */
+
+#ifndef SHM_REPLAY_H
+#define SHM_REPLAY_H
+
+#include <cerrno>
+#include <cstdint>
+#include <ctime>
+
+#include "shm_comm.h"
+#include "shm_journal.h"
+
+/*
+ * ShmReplayStats struct definitions
+ */
+
+struct ShmReplayStats
+{
+    std::uint64_t mNumReplayed;
+    std::uint64_t mElapsedNs;
+
+    inline double Throughput() const
+    { return this->mElapsedNs == 0 ? 0.0 :
+             this->mNumReplayed * 1e9 / this->mElapsedNs; }
+};
+
+/*
+ * JournalReplayer class definitions
+ *
+ * Drives a DataPublisher with the data records of a journal. A speed of
+ * 1.0 keeps the recorded inter-arrival times, 2.0 replays twice as fast
+ * and 0.0 publishes each request as soon as the previous result arrived.
+ */
+
+template <typename DataType, typename ResultType>
+class JournalReplayer
+{
+public:
+    typedef JournalReader<DataType, ResultType>  ReaderType;
+    typedef DataPublisher<DataType, ResultType>  PublisherType;
+
+public:
+    JournalReplayer(const ReaderType& journalReader,
+                    PublisherType& dataPublisher);
+    ~JournalReplayer() { }
+
+    bool Replay(double speed, ShmReplayStats& replayStats);
+
+private:
+    JournalReplayer(const JournalReplayer& other);
+    JournalReplayer(JournalReplayer&& other);
+    JournalReplayer& operator=(const JournalReplayer& other);
+    JournalReplayer& operator=(JournalReplayer&& other);
+
+    static void SleepUntil(std::uint64_t timestamp);
+
+private:
+    const ReaderType& mReader;
+    PublisherType&    mPublisher;
+};
+
+/*
+ * JournalReplayer class methods
+ */
+
+template <typename DataType, typename ResultType>
+JournalReplayer<DataType, ResultType>::JournalReplayer(
+    const ReaderType& journalReader, PublisherType& dataPublisher) :
+    mReader(journalReader),
+    mPublisher(dataPublisher)
+{
+}
+
+template <typename DataType, typename ResultType>
+bool JournalReplayer<DataType, ResultType>::Replay(
+    double speed, ShmReplayStats& replayStats)
+{
+    if (speed < 0.0) {
+        std::cerr << "Invalid replay speed" << std::endl;
+        return false;
+    }
+
+    std::uint64_t numRecords = this->mReader.NumRecords();
+    std::uint64_t firstTimestamp = 0;
+    bool firstRecord = true;
+    std::uint64_t startTime = ShmJournalTimestamp();
+
+    replayStats.mNumReplayed = 0;
+
+    for (std::uint64_t i = 0; i < numRecords; ++i) {
+        const ShmJournalRecord& record = this->mReader.GetRecord(i);
+
+        if (record.mKind != ShmJournalRecordKind::DataRecord)
+            continue;
+
+        if (firstRecord) {
+            firstTimestamp = record.mTimestamp;
+            firstRecord = false;
+        }
+
+        /* Concurrent writers take the timestamp before reserving their
+         * index slot, so a record may be older than the first one */
+        std::uint64_t recordOffset =
+            record.mTimestamp > firstTimestamp ?
+            record.mTimestamp - firstTimestamp : 0;
+
+        /* Wait until the scaled offset of this record has passed */
+        if (speed > 0.0)
+            SleepUntil(startTime + static_cast<std::uint64_t>(
+                recordOffset / speed));
+
+        DataType sharedData = this->mReader.GetData(i);
+        this->mPublisher.Publish(sharedData);
+        this->mPublisher.WaitForResult();
+
+        ++replayStats.mNumReplayed;
+    }
+
+    replayStats.mElapsedNs = ShmJournalTimestamp() - startTime;
+
+    return true;
+}
+
+template <typename DataType, typename ResultType>
+void JournalReplayer<DataType, ResultType>::SleepUntil(
+    std::uint64_t timestamp)
+{
+    struct timespec timeSpec;
+    timeSpec.tv_sec = timestamp / 1000000000ULL;
+    timeSpec.tv_nsec = timestamp % 1000000000ULL;
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+                           &timeSpec, NULL) == EINTR)
+        ;
+}
+
+#endif /* SHM_REPLAY_H */
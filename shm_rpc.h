@@ -0,0 +1,233 @@
+
+/* shm_rpc.h */
+
+#ifndef SHM_RPC_H
+#define SHM_RPC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "shm_comm.h"
+
+/*
+ * Type helper definitions
+ */
+
+template <typename T, typename... Ts>
+constexpr std::size_t RpcIndexOf()
+{
+    constexpr bool matches[] = { std::is_same<T, Ts>::value... };
+
+    for (std::size_t i = 0; i < sizeof...(Ts); ++i)
+        if (matches[i])
+            return i;
+
+    return sizeof...(Ts);
+}
+
+template <typename... Ts>
+constexpr std::size_t RpcMaxSize()
+{
+    constexpr std::size_t sizes[] = { sizeof(Ts)... };
+    std::size_t maxSize = 0;
+
+    for (std::size_t size : sizes)
+        maxSize = size > maxSize ? size : maxSize;
+
+    return maxSize;
+}
+
+/* Combine handler lambdas into one overloaded handler */
+template <typename... HandlerFns>
+struct RpcHandlers : HandlerFns...
+{
+    using HandlerFns::operator()...;
+};
+
+template <typename... HandlerFns>
+RpcHandlers(HandlerFns...) -> RpcHandlers<HandlerFns...>;
+
+/*
+ * RpcSlot struct definitions
+ *
+ * Shared memory representation of a std::variant of method structs. The
+ * storage is sized for the largest alternative, but storing a method only
+ * copies the bytes of that alternative.
+ */
+
+template <typename VariantType>
+struct RpcSlot;
+
+template <typename... Methods>
+struct RpcSlot<std::variant<Methods...>>
+{
+public:
+    static const std::size_t NumMethods = sizeof...(Methods);
+
+    template <typename Method>
+    inline void Store(const Method& method)
+    {
+        static_assert(RpcIndexOf<Method, Methods...>() < NumMethods,
+                      "Method is not an alternative of the variant");
+        this->mIndex = RpcIndexOf<Method, Methods...>();
+        std::memcpy(this->mStorage, &method, sizeof(Method));
+    }
+
+    template <typename Method>
+    inline const Method* GetIf() const
+    {
+        return this->mIndex == RpcIndexOf<Method, Methods...>() ?
+               reinterpret_cast<const Method*>(this->mStorage) : NULL;
+    }
+
+    /* Call visitor with the active alternative, selected by a chain of
+     * index comparisons generated at compile time */
+    template <typename Visitor>
+    inline void Visit(Visitor& visitor) const
+    {
+        this->Visit(visitor, std::index_sequence_for<Methods...>());
+    }
+
+    inline std::size_t GetIndex() const { return this->mIndex; }
+
+private:
+    static_assert((std::is_trivially_copyable<Methods>::value && ...),
+                  "Methods must be trivially copyable");
+
+    template <typename Visitor, std::size_t... Indices>
+    inline void Visit(Visitor& visitor,
+                      std::index_sequence<Indices...>) const
+    {
+        ((this->mIndex == Indices &&
+          (visitor(*reinterpret_cast<const Methods*>(this->mStorage)),
+           true)) || ...);
+    }
+
+private:
+    std::uint32_t mIndex;
+    alignas(Methods...) unsigned char mStorage[RpcMaxSize<Methods...>()];
+};
+
+/*
+ * RpcPublisher class definitions
+ */
+
+template <typename RequestType, typename ResponseType>
+class RpcPublisher
+{
+public:
+    typedef RpcSlot<RequestType>                        RequestSlotType;
+    typedef RpcSlot<ResponseType>                       ResponseSlotType;
+    typedef DataPublisher<RequestSlotType, ResponseSlotType> PublisherType;
+
+public:
+    RpcPublisher() { }
+    ~RpcPublisher() { }
+
+    inline bool Initialize(const char* sharedMemoryName)
+    { return this->mPublisher.Initialize(sharedMemoryName); }
+    inline void Destroy() { this->mPublisher.Destroy(); }
+    inline void WaitForResult() { this->mPublisher.WaitForResult(); }
+    inline void Stop() { this->mPublisher.Stop(); }
+
+    template <typename Method>
+    void Call(const Method& request);
+
+    template <typename Method>
+    inline const Method* GetResultIf() const
+    { return this->mPublisher.GetResult().template GetIf<Method>(); }
+    template <typename Visitor>
+    inline void VisitResult(Visitor& visitor) const
+    { this->mPublisher.GetResult().Visit(visitor); }
+
+private:
+    RpcPublisher(const RpcPublisher& other);
+    RpcPublisher(RpcPublisher&& other);
+    RpcPublisher& operator=(const RpcPublisher& other);
+    RpcPublisher& operator=(RpcPublisher&& other);
+
+private:
+    PublisherType mPublisher;
+};
+
+/*
+ * RpcPublisher class methods
+ */
+
+template <typename RequestType, typename ResponseType>
+template <typename Method>
+void RpcPublisher<RequestType, ResponseType>::Call(const Method& request)
+{
+    /* Write request directly into shared memory */
+    this->mPublisher.PublishWith([&request](RequestSlotType& requestSlot) {
+        requestSlot.Store(request);
+    });
+}
+
+/*
+ * RpcSubscriber class definitions
+ */
+
+template <typename RequestType, typename ResponseType>
+class RpcSubscriber
+{
+public:
+    typedef RpcSlot<RequestType>                        RequestSlotType;
+    typedef RpcSlot<ResponseType>                       ResponseSlotType;
+    typedef DataSubscriber<RequestSlotType, ResponseSlotType> SubscriberType;
+
+public:
+    RpcSubscriber() { }
+    ~RpcSubscriber() { }
+
+    inline bool Initialize(const char* sharedMemoryName)
+    { return this->mSubscriber.Initialize(sharedMemoryName); }
+    inline void Destroy() { this->mSubscriber.Destroy(); }
+
+    template <typename Handler>
+    bool Serve(Handler& handler);
+
+private:
+    RpcSubscriber(const RpcSubscriber& other);
+    RpcSubscriber(RpcSubscriber&& other);
+    RpcSubscriber& operator=(const RpcSubscriber& other);
+    RpcSubscriber& operator=(RpcSubscriber&& other);
+
+private:
+    SubscriberType mSubscriber;
+};
+
+/*
+ * RpcSubscriber class methods
+ */
+
+template <typename RequestType, typename ResponseType>
+template <typename Handler>
+bool RpcSubscriber<RequestType, ResponseType>::Serve(Handler& handler)
+{
+    /* Wait for a request, returns false once publisher stopped */
+    if (!this->mSubscriber.Subscribe())
+        return false;
+
+    const RequestSlotType& requestSlot = this->mSubscriber.GetData();
+    ResponseSlotType& responseSlot = this->mSubscriber.GetResultBuffer();
+
+    /* Handler overload for the method is chosen at compile time and its
+     * response is written directly into shared memory; the publisher does
+     * not touch the result until it is sent, so the handler runs without
+     * holding the channel lock */
+    auto invokeHandler = [&handler, &responseSlot](const auto& request) {
+        responseSlot.Store(handler(request));
+    };
+    requestSlot.Visit(invokeHandler);
+
+    this->mSubscriber.SendResult();
+
+    return true;
+}
+
+#endif /* SHM_RPC_H */
@@ -0,0 +1,343 @@
+
+/* shm_sharded.h */
+
+#ifndef SHM_SHARDED_H
+#define SHM_SHARDED_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "shm_comm.h"
+
+/*
+ * ShardedPublisher class definitions
+ *
+ * Owns one DataPublisher per worker and routes each message by the key
+ * returned from KeyFn()(data). Shards are placed on a consistent hash
+ * ring, so all messages with the same key go to the same worker (and are
+ * processed in order) and adding or removing a worker only moves the keys
+ * on the affected arcs of the ring.
+ *
+ * The channel of shard N is named "<baseName>.<N>"; a worker attaches to
+ * it with an ordinary DataSubscriber. Shard identifiers are never reused.
+ *
+ * Each shard carries at most one request: its result must be collected
+ * with WaitForResult() before the next request for that shard is
+ * published. If a worker dies, WaitForResult() returns false and the
+ * request can be published again once the shard has been removed. A
+ * worker that has not attached to its channel yet is waited for.
+ */
+
+template <typename DataType, typename ResultType, typename KeyFn>
+class ShardedPublisher
+{
+public:
+    typedef DataPublisher<DataType, ResultType> PublisherType;
+    typedef typename std::decay<
+        decltype(std::declval<KeyFn>()(std::declval<DataType&>()))>::type
+        KeyType;
+
+    /* Number of points each shard occupies on the hash ring */
+    static const unsigned int VirtualNodes = 64;
+
+public:
+    ShardedPublisher();
+    ~ShardedPublisher();
+
+    bool Initialize(const char* baseName, unsigned int numShards);
+    void Destroy();
+    bool Publish(DataType& sharedData, unsigned int& shardId);
+    bool WaitForResult(unsigned int shardId);
+    void Stop();
+
+    bool AddShard(unsigned int& shardId);
+    bool RemoveShard(unsigned int shardId);
+
+    bool ShardForKey(const KeyType& key, unsigned int& shardId) const;
+    inline unsigned int NumShards() const { return this->mShards.size(); }
+    inline bool ShardAlive(unsigned int shardId) const
+    { return this->mShards.at(shardId)->mPublisher.SubscriberAlive(); }
+    inline ResultType& GetResult(unsigned int shardId) const
+    { return this->mShards.at(shardId)->mPublisher.GetResult(); }
+
+private:
+    ShardedPublisher(const ShardedPublisher& other);
+    ShardedPublisher(ShardedPublisher&& other);
+    ShardedPublisher& operator=(const ShardedPublisher& other);
+    ShardedPublisher& operator=(ShardedPublisher&& other);
+
+    struct Shard
+    {
+        std::string   mName;
+        PublisherType mPublisher;
+        bool          mInFlight;
+        bool          mDrained;
+        bool          mLost;
+    };
+
+    static std::uint64_t MixHash(std::uint64_t value);
+    void Drain();
+
+private:
+    std::string                                      mBaseName;
+    std::map<unsigned int, std::unique_ptr<Shard>>   mShards;
+    std::map<std::uint64_t, unsigned int>            mRing;
+    unsigned int                                     mNextShardId;
+};
+
+/*
+ * ShardedPublisher class methods
+ */
+
+template <typename DataType, typename ResultType, typename KeyFn>
+ShardedPublisher<DataType, ResultType, KeyFn>::ShardedPublisher() :
+    mNextShardId(0)
+{
+}
+
+template <typename DataType, typename ResultType, typename KeyFn>
+ShardedPublisher<DataType, ResultType, KeyFn>::~ShardedPublisher()
+{
+    this->Destroy();
+}
+
+template <typename DataType, typename ResultType, typename KeyFn>
+bool ShardedPublisher<DataType, ResultType, KeyFn>::Initialize(
+    const char* baseName, unsigned int numShards)
+{
+    if (!baseName) {
+        std::cerr << "Invalid shared memory name" << std::endl;
+        return false;
+    }
+
+    if (numShards == 0) {
+        std::cerr << "Invalid number of shards" << std::endl;
+        return false;
+    }
+
+    this->mBaseName = baseName;
+
+    for (unsigned int i = 0; i < numShards; ++i) {
+        unsigned int shardId;
+
+        if (!this->AddShard(shardId)) {
+            this->Destroy();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template <typename DataType, typename ResultType, typename KeyFn>
+void ShardedPublisher<DataType, ResultType, KeyFn>::Destroy()
+{
+    /* Destroying each publisher also unlinks its shared memory */
+    this->mShards.clear();
+    this->mRing.clear();
+    this->mBaseName.clear();
+    this->mNextShardId = 0;
+}
+
+template <typename DataType, typename ResultType, typename KeyFn>
+bool ShardedPublisher<DataType, ResultType, KeyFn>::Publish(
+    DataType& sharedData, unsigned int& shardId)
+{
+    if (this->mRing.empty()) {
+        std::cerr << "Error: no shards to publish to" << std::endl;
+        return false;
+    }
+
+    this->ShardForKey(KeyFn()(sharedData), shardId);
+    Shard& shard = *this->mShards.at(shardId);
+
+    /* Publishing again would overwrite the result of the previous request
+     * of this shard before the caller has read it */
+    if (shard.mInFlight) {
+        std::cerr << "Error: result of shard " << shardId
+                  << " has not been collected" << std::endl;
+        return false;
+    }
+
+    if (!shard.mPublisher.SubscriberAlive()) {
+        std::cerr << "Error: worker of shard " << shardId
+                  << " has died" << std::endl;
+        return false;
+    }
+
+    shard.mPublisher.Publish(sharedData);
+    shard.mInFlight = true;
+    shard.mDrained = false;
+    shard.mLost = false;
+
+    return true;
+}
+
+template <typename DataType, typename ResultType, typename KeyFn>
+bool ShardedPublisher<DataType, ResultType, KeyFn>::WaitForResult(
+    unsigned int shardId)
+{
+    Shard& shard = *this->mShards.at(shardId);
+
+    if (!shard.mInFlight) {
+        std::cerr << "Error: no request in flight on shard "
+                  << shardId << std::endl;
+        return false;
+    }
+
+    /* Result may already have been received while rebalancing */
+    if (!shard.mDrained && !shard.mPublisher.WaitForLiveResult())
+        shard.mLost = true;
+
+    shard.mInFlight = false;
+    shard.mDrained = false;
+
+    if (shard.mLost) {
+        std::cerr << "Error: worker of shard " << shardId
+                  << " died before sending its result" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+template <typename DataType, typename ResultType, typename KeyFn>
+void ShardedPublisher<DataType, ResultType, KeyFn>::Stop()
+{
+    for (auto& entry : this->mShards)
+        entry.second->mPublisher.Stop();
+}
+
+template <typename DataType, typename ResultType, typename KeyFn>
+bool ShardedPublisher<DataType, ResultType, KeyFn>::AddShard(
+    unsigned int& shardId)
+{
+    std::unique_ptr<Shard> pShard(new Shard());
+    pShard->mName = this->mBaseName + "." +
+                    std::to_string(this->mNextShardId);
+    pShard->mInFlight = false;
+    pShard->mDrained = false;
+    pShard->mLost = false;
+
+    if (!pShard->mPublisher.Initialize(pShard->mName.c_str())) {
+        std::cerr << "Error: failed to create shard "
+                  << pShard->mName << std::endl;
+        return false;
+    }
+
+    /* Keys that move to the new shard must not overtake requests still
+     * running on their old shard */
+    this->Drain();
+
+    shardId = this->mNextShardId++;
+
+    for (unsigned int i = 0; i < VirtualNodes; ++i) {
+        /* Seed differs from the key hash so that small shard numbers do
+         * not land exactly on the points of small integer keys */
+        std::uint64_t point = MixHash(
+            MixHash(shardId + 0x9e3779b97f4a7c15ULL) + i);
+        this->mRing.emplace(point, shardId);
+    }
+
+    this->mShards.emplace(shardId, std::move(pShard));
+
+    return true;
+}
+
+template <typename DataType, typename ResultType, typename KeyFn>
+bool ShardedPublisher<DataType, ResultType, KeyFn>::RemoveShard(
+    unsigned int shardId)
+{
+    auto shardIt = this->mShards.find(shardId);
+
+    if (shardIt == this->mShards.end()) {
+        std::cerr << "Error: no such shard: " << shardId << std::endl;
+        return false;
+    }
+
+    if (this->mShards.size() == 1) {
+        std::cerr << "Error: cannot remove the last shard" << std::endl;
+        return false;
+    }
+
+    if (shardIt->second->mInFlight) {
+        std::cerr << "Error: result of shard " << shardId
+                  << " has not been collected" << std::endl;
+        return false;
+    }
+
+    /* Keys of the removed shard move to their successors on the ring,
+     * which must not start them before older requests have finished */
+    this->Drain();
+
+    for (auto it = this->mRing.begin(); it != this->mRing.end(); ) {
+        if (it->second == shardId)
+            it = this->mRing.erase(it);
+        else
+            ++it;
+    }
+
+    /* Let the worker exit before its channel is torn down */
+    shardIt->second->mPublisher.Stop();
+    this->mShards.erase(shardIt);
+
+    return true;
+}
+
+template <typename DataType, typename ResultType, typename KeyFn>
+bool ShardedPublisher<DataType, ResultType, KeyFn>::ShardForKey(
+    const KeyType& key, unsigned int& shardId) const
+{
+    if (this->mRing.empty())
+        return false;
+
+    std::uint64_t point = MixHash(std::hash<KeyType>()(key));
+
+    /* First shard clockwise from the key on the ring */
+    auto it = this->mRing.lower_bound(point);
+
+    if (it == this->mRing.end())
+        it = this->mRing.begin();
+
+    shardId = it->second;
+
+    return true;
+}
+
+template <typename DataType, typename ResultType, typename KeyFn>
+std::uint64_t ShardedPublisher<DataType, ResultType, KeyFn>::MixHash(
+    std::uint64_t value)
+{
+    /* splitmix64 finalizer, since std::hash is the identity for integers */
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+
+    return value;
+}
+
+template <typename DataType, typename ResultType, typename KeyFn>
+void ShardedPublisher<DataType, ResultType, KeyFn>::Drain()
+{
+    /* Wait for every outstanding request; the results stay readable
+     * through GetResult() until they are collected. Requests of a worker
+     * that died are withdrawn and reported by WaitForResult() */
+    for (auto& entry : this->mShards) {
+        Shard& shard = *entry.second;
+
+        if (shard.mInFlight && !shard.mDrained && !shard.mLost) {
+            if (!shard.mPublisher.WaitForLiveResult())
+                shard.mLost = true;
+            shard.mDrained = true;
+        }
+    }
+}
+
+#endif /* SHM_SHARDED_H */
@@ -0,0 +1,57 @@
+
+/* test_coalesce_publisher.cpp */
+
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "shm_comm.h"
+
+int main(int argc, char** argv)
+{
+    const char* sharedMemoryName = "/test_coalesce";
+    DataPublisher<int, long> dataPub;
+    std::mutex outputMutex;
+
+    if (!dataPub.Initialize(sharedMemoryName)) {
+        std::cerr << "Publisher: initialization failed"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cerr << "Publisher: started" << std::endl;
+
+    /* Threads sharing the publisher ask for the same few keys, so equal
+     * requests in flight are computed only once */
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&dataPub, &outputMutex, t]() {
+            for (int i = 0; i < 3; ++i) {
+                int publishedData = i;
+                long resultData;
+                bool joined = dataPub.PublishCoalesced(publishedData);
+                dataPub.WaitForResult(resultData);
+
+                std::lock_guard<std::mutex> outputLock(outputMutex);
+                std::cerr << "Publisher thread " << t << ": "
+                          << (joined ? "joined" : "published")
+                          << " key " << publishedData
+                          << ", result received: " << resultData
+                          << std::endl;
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+        thread.join();
+
+    dataPub.Stop();
+    std::cerr << "Publisher: stopped" << std::endl;
+
+    dataPub.Destroy();
+
+    return EXIT_SUCCESS;
+}
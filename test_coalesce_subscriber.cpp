@@ -0,0 +1,42 @@
+
+/* test_coalesce_subscriber.cpp */
+
+#include <cstdlib>
+#include <iostream>
+
+#include "shm_comm.h"
+
+int main(int argc, char** argv)
+{
+    const char* sharedMemoryName = "/test_coalesce";
+    DataSubscriber<int, long> dataSub;
+    int numComputed = 0;
+
+    if (!dataSub.Initialize(sharedMemoryName)) {
+        std::cerr << "Subscriber: initialization failed"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cerr << "Subscriber: started" << std::endl;
+
+    while (dataSub.Subscribe()) {
+        int receivedData = dataSub.GetData();
+        std::cerr << "Subscriber: key received: "
+                  << receivedData << std::endl;
+
+        /* Slow computation gives other publishers time to join */
+        usleep(100000);
+
+        long resultData = static_cast<long>(receivedData) * receivedData;
+        dataSub.SendResult(resultData);
+        ++numComputed;
+    }
+
+    std::cerr << "Subscriber: exiting after " << numComputed
+              << " computations" << std::endl;
+
+    dataSub.Destroy();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,61 @@
+
+/* test_delta_publisher.cpp */
+
+#include <cstdlib>
+#include <iostream>
+
+#include "shm_comm.h"
+#include "test_delta_types.h"
+
+int main(int argc, char** argv)
+{
+    const char* sharedMemoryName = "/test_delta";
+    DataPublisher<ValueTable, long> dataPub;
+    ValueTable valueTable = { };
+
+    if (!dataPub.Initialize(sharedMemoryName)) {
+        std::cerr << "Publisher: initialization failed"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cerr << "Publisher: started" << std::endl;
+
+    for (int i = 0; i < 5; ++i) {
+        /* Only the changed cache lines are copied to shared memory */
+        valueTable.mValues[i * 100] += i + 1;
+        valueTable.mValues[1023] += 1;
+        dataPub.PublishDelta(valueTable);
+        std::cerr << "Publisher: table " << i << " published" << std::endl;
+
+        dataPub.WaitForResult();
+        std::cerr << "Publisher: sum received: "
+                  << dataPub.GetResult() << std::endl;
+    }
+
+    /* Ranges may also be given by the caller; one that does not lie
+     * within the table falls back to a full copy */
+    const ShmDirtyRange dirtyRanges[] = {
+        { 0, 64 },
+        { sizeof(ValueTable) - 64, 128 },
+    };
+
+    valueTable.mValues[0] = 100;
+    dataPub.PublishDelta(valueTable, dirtyRanges, 1);
+    dataPub.WaitForResult();
+    std::cerr << "Publisher: sum received: "
+              << dataPub.GetResult() << std::endl;
+
+    valueTable.mValues[1023] = 100;
+    dataPub.PublishDelta(valueTable, dirtyRanges, 2);
+    dataPub.WaitForResult();
+    std::cerr << "Publisher: sum received: "
+              << dataPub.GetResult() << std::endl;
+
+    dataPub.Stop();
+    std::cerr << "Publisher: stopped" << std::endl;
+
+    dataPub.Destroy();
+
+    return EXIT_SUCCESS;
+}
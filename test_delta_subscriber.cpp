@@ -0,0 +1,48 @@
+
+/* test_delta_subscriber.cpp */
+
+#include <cstdlib>
+#include <iostream>
+
+#include "shm_comm.h"
+#include "test_delta_types.h"
+
+int main(int argc, char** argv)
+{
+    const char* sharedMemoryName = "/test_delta";
+    DataSubscriber<ValueTable, long> dataSub;
+
+    if (!dataSub.Initialize(sharedMemoryName)) {
+        std::cerr << "Subscriber: initialization failed"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cerr << "Subscriber: started" << std::endl;
+
+    while (dataSub.Subscribe()) {
+        std::size_t numRanges;
+        const ShmDirtyRange* pRanges = dataSub.GetDirtyRanges(numRanges);
+        std::size_t numBytes = 0;
+
+        for (std::size_t i = 0; i < numRanges; ++i)
+            numBytes += pRanges[i].mLength;
+
+        std::cerr << "Subscriber: " << numRanges << " dirty ranges, "
+                  << numBytes << " bytes" << std::endl;
+
+        const ValueTable& valueTable = dataSub.GetData();
+        long resultData = 0;
+
+        for (int value : valueTable.mValues)
+            resultData += value;
+
+        dataSub.SendResult(resultData);
+    }
+
+    std::cerr << "Subscriber: exiting" << std::endl;
+
+    dataSub.Destroy();
+
+    return EXIT_SUCCESS;
+}
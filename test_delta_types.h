@@ -0,0 +1,17 @@
+
+/* test_delta_types.h */
+
+#ifndef TEST_DELTA_TYPES_H
+#define TEST_DELTA_TYPES_H
+
+/*
+ * Types shared by the delta publisher and subscriber
+ */
+
+/* Only a few entries change between requests */
+struct ValueTable
+{
+    int mValues[1024];
+};
+
+#endif /* TEST_DELTA_TYPES_H */
@@ -0,0 +1,44 @@
+
+/* test_inplace_publisher.cpp */
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#include "shm_comm.h"
+#include "test_inplace_types.h"
+
+int main(int argc, char** argv)
+{
+    const char* sharedMemoryName = "/test_inplace";
+    DataPublisher<TextBuffer, InPlaceResult<int>> dataPub;
+
+    if (!dataPub.Initialize(sharedMemoryName)) {
+        std::cerr << "Publisher: initialization failed"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cerr << "Publisher: started" << std::endl;
+
+    for (int i = 0; i < 5; ++i) {
+        /* Request text is written straight into the shared buffer */
+        dataPub.PublishWith([i](TextBuffer& textBuffer) {
+            std::snprintf(textBuffer.mText, sizeof(textBuffer.mText),
+                          "request %d %*s", i, i * 8, "");
+        });
+        std::cerr << "Publisher: text " << i << " published" << std::endl;
+
+        /* Result has replaced the request in the same buffer */
+        dataPub.WaitForResult();
+        std::cerr << "Publisher: length received: "
+                  << dataPub.GetResult() << std::endl;
+    }
+
+    dataPub.Stop();
+    std::cerr << "Publisher: stopped" << std::endl;
+
+    dataPub.Destroy();
+
+    return EXIT_SUCCESS;
+}
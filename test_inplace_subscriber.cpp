@@ -0,0 +1,40 @@
+
+/* test_inplace_subscriber.cpp */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "shm_comm.h"
+#include "test_inplace_types.h"
+
+int main(int argc, char** argv)
+{
+    const char* sharedMemoryName = "/test_inplace";
+    DataSubscriber<TextBuffer, InPlaceResult<int>> dataSub;
+
+    if (!dataSub.Initialize(sharedMemoryName)) {
+        std::cerr << "Subscriber: initialization failed"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cerr << "Subscriber: started" << std::endl;
+
+    while (dataSub.Subscribe()) {
+        const TextBuffer& textBuffer = dataSub.GetData();
+        int textLength = std::strlen(textBuffer.mText);
+        std::cerr << "Subscriber: text received: \""
+                  << textBuffer.mText << "\"" << std::endl;
+
+        /* Request is consumed, so the result may overwrite it */
+        dataSub.GetResultBuffer() = textLength;
+        dataSub.SendResult();
+    }
+
+    std::cerr << "Subscriber: exiting" << std::endl;
+
+    dataSub.Destroy();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,17 @@
+
+/* test_inplace_types.h */
+
+#ifndef TEST_INPLACE_TYPES_H
+#define TEST_INPLACE_TYPES_H
+
+/*
+ * Types shared by the in-place publisher and subscriber
+ */
+
+/* Length of the text is written over the text */
+struct TextBuffer
+{
+    char mText[4096];
+};
+
+#endif /* TEST_INPLACE_TYPES_H */
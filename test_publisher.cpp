@@ -17,6 +17,19 @@ int main(int argc, char** argv)
         return EXIT_FAILURE;
     }
 
+    /* Record published data and results if a journal file is given */
+    MessageJournal<int, double> journal;
+
+    if (argc > 1) {
+        if (!journal.Create(argv[1], 1024, true)) {
+            std::cerr << "Publisher: failed to create journal"
+                      << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        dataPub.SetJournal(&journal);
+    }
+
     std::cerr << "Publisher: started" << std::endl;
 
     for (int i = 0; i < 5; ++i) {
@@ -39,6 +52,7 @@ int main(int argc, char** argv)
     std::cerr << "Publisher: stopped" << std::endl;
 
     dataPub.Destroy();
+    journal.Close();
 
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,53 @@
+
+/* test_replay.cpp */
+
+#include <cstdlib>
+#include <iostream>
+
+#include "shm_replay.h"
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <journal file> [speed (0 for maximum)]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const char* sharedMemoryName = "/test";
+    double speed = argc > 2 ? std::atof(argv[2]) : 1.0;
+    JournalReader<int, double> journalReader;
+    DataPublisher<int, double> dataPub;
+
+    if (!journalReader.Open(argv[1])) {
+        std::cerr << "Replay: failed to open journal" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!dataPub.Initialize(sharedMemoryName)) {
+        std::cerr << "Replay: initialization failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cerr << "Replay: started" << std::endl;
+
+    JournalReplayer<int, double> journalReplayer(journalReader, dataPub);
+    ShmReplayStats replayStats;
+
+    if (!journalReplayer.Replay(speed, replayStats)) {
+        std::cerr << "Replay: replay failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cerr << "Replay: " << replayStats.mNumReplayed << " requests in "
+              << replayStats.mElapsedNs / 1e6 << " ms ("
+              << replayStats.Throughput() << " requests/s)" << std::endl;
+
+    dataPub.Stop();
+    std::cerr << "Replay: stopped" << std::endl;
+
+    dataPub.Destroy();
+    journalReader.Close();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,49 @@
+
+/* test_resize_publisher.cpp */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "shm_comm.h"
+
+int main(int argc, char** argv)
+{
+    const char* sharedMemoryName = "/test_resize";
+    DataPublisher<std::size_t, long> dataPub;
+    ShmCommOptions options;
+    options.mArenaSize = 4096;
+
+    if (!dataPub.Initialize(sharedMemoryName, options)) {
+        std::cerr << "Publisher: initialization failed"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cerr << "Publisher: started" << std::endl;
+
+    for (std::size_t arenaSize = 4096; arenaSize <= 16 << 20;
+         arenaSize *= 16) {
+        /* Grow the arena before publishing data that uses it */
+        if (!dataPub.Resize(arenaSize)) {
+            std::cerr << "Publisher: failed to resize arena" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        std::memset(dataPub.GetArena(), 1, arenaSize);
+        dataPub.Publish(arenaSize);
+        std::cerr << "Publisher: " << arenaSize
+                  << " arena bytes published" << std::endl;
+
+        dataPub.WaitForResult();
+        std::cerr << "Publisher: sum received: "
+                  << dataPub.GetResult() << std::endl;
+    }
+
+    dataPub.Stop();
+    std::cerr << "Publisher: stopped" << std::endl;
+
+    dataPub.Destroy();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,46 @@
+
+/* test_resize_subscriber.cpp */
+
+#include <cstdlib>
+#include <iostream>
+
+#include "shm_comm.h"
+
+int main(int argc, char** argv)
+{
+    const char* sharedMemoryName = "/test_resize";
+    DataSubscriber<std::size_t, long> dataSub;
+
+    if (!dataSub.Initialize(sharedMemoryName)) {
+        std::cerr << "Subscriber: initialization failed"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cerr << "Subscriber: started" << std::endl;
+
+    /* Subscribe() remaps the segment once the publisher has grown it */
+    while (dataSub.Subscribe()) {
+        std::size_t usedSize = dataSub.GetData();
+        const unsigned char* pArena =
+            static_cast<const unsigned char*>(dataSub.GetArena());
+        long resultData = 0;
+
+        std::cerr << "Subscriber: arena of " << dataSub.GetArenaSize()
+                  << " bytes mapped" << std::endl;
+
+        if (usedSize > dataSub.GetArenaSize())
+            usedSize = dataSub.GetArenaSize();
+
+        for (std::size_t i = 0; i < usedSize; ++i)
+            resultData += pArena[i];
+
+        dataSub.SendResult(resultData);
+    }
+
+    std::cerr << "Subscriber: exiting" << std::endl;
+
+    dataSub.Destroy();
+
+    return EXIT_SUCCESS;
+}
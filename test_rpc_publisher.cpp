@@ -0,0 +1,51 @@
+
+/* test_rpc_publisher.cpp */
+
+#include <cstdlib>
+#include <iostream>
+
+#include "shm_rpc.h"
+#include "test_rpc_types.h"
+
+int main(int argc, char** argv)
+{
+    const char* sharedMemoryName = "/test_rpc";
+    RpcPublisher<RpcRequest, RpcResponse> rpcPub;
+
+    if (!rpcPub.Initialize(sharedMemoryName)) {
+        std::cerr << "Publisher: initialization failed"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cerr << "Publisher: started" << std::endl;
+
+    auto printResponse = RpcHandlers {
+        [](const AddResponse& response) {
+            std::cerr << "Publisher: sum received: "
+                      << response.mSum << std::endl;
+        },
+        [](const ScaleResponse& response) {
+            std::cerr << "Publisher: product received: "
+                      << response.mProduct << std::endl;
+        },
+    };
+
+    for (int i = 0; i < 5; ++i) {
+        /* Methods of different size share the channel */
+        if (i % 2 == 0)
+            rpcPub.Call(AddRequest { i, 10 });
+        else
+            rpcPub.Call(ScaleRequest { i * 1.0, 1.5 });
+
+        rpcPub.WaitForResult();
+        rpcPub.VisitResult(printResponse);
+    }
+
+    rpcPub.Stop();
+    std::cerr << "Publisher: stopped" << std::endl;
+
+    rpcPub.Destroy();
+
+    return EXIT_SUCCESS;
+}
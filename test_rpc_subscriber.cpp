@@ -0,0 +1,45 @@
+
+/* test_rpc_subscriber.cpp */
+
+#include <cstdlib>
+#include <iostream>
+
+#include "shm_rpc.h"
+#include "test_rpc_types.h"
+
+int main(int argc, char** argv)
+{
+    const char* sharedMemoryName = "/test_rpc";
+    RpcSubscriber<RpcRequest, RpcResponse> rpcSub;
+
+    if (!rpcSub.Initialize(sharedMemoryName)) {
+        std::cerr << "Subscriber: initialization failed"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cerr << "Subscriber: started" << std::endl;
+
+    /* Each handler returns the response alternative of its method */
+    auto handlers = RpcHandlers {
+        [](const AddRequest& request) {
+            std::cerr << "Subscriber: add " << request.mLhs
+                      << " + " << request.mRhs << std::endl;
+            return AddResponse { request.mLhs + request.mRhs };
+        },
+        [](const ScaleRequest& request) {
+            std::cerr << "Subscriber: scale " << request.mValue
+                      << " * " << request.mFactor << std::endl;
+            return ScaleResponse { request.mValue * request.mFactor };
+        },
+    };
+
+    while (rpcSub.Serve(handlers))
+        ;
+
+    std::cerr << "Subscriber: exiting" << std::endl;
+
+    rpcSub.Destroy();
+
+    return EXIT_SUCCESS;
+}
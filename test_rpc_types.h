@@ -0,0 +1,39 @@
+
+/* test_rpc_types.h */
+
+#ifndef TEST_RPC_TYPES_H
+#define TEST_RPC_TYPES_H
+
+#include <variant>
+
+/*
+ * Types shared by the RPC publisher and subscriber
+ */
+
+/* Two methods over one channel */
+struct AddRequest
+{
+    int mLhs;
+    int mRhs;
+};
+
+struct ScaleRequest
+{
+    double mValue;
+    double mFactor;
+};
+
+struct AddResponse
+{
+    int mSum;
+};
+
+struct ScaleResponse
+{
+    double mProduct;
+};
+
+typedef std::variant<AddRequest, ScaleRequest>   RpcRequest;
+typedef std::variant<AddResponse, ScaleResponse> RpcResponse;
+
+#endif /* TEST_RPC_TYPES_H */
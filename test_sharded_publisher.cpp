@@ -0,0 +1,110 @@
+
+/* test_sharded_publisher.cpp */
+
+#include <cstdlib>
+#include <iostream>
+
+#include "shm_sharded.h"
+#include "test_sharded_types.h"
+
+typedef ShardedPublisher<ShardRequest, int, ShardRequestKey> PublisherType;
+
+static bool SendRequest(PublisherType& shardedPub, ShardRequest& request)
+{
+    unsigned int shardId;
+
+    if (!shardedPub.Publish(request, shardId))
+        return false;
+
+    std::cerr << "Publisher: key " << request.mKey
+              << ", sequence " << request.mSequence
+              << " published to shard " << shardId << std::endl;
+
+    /* Result must be collected before the shard takes the next request;
+     * a request whose worker died goes to the shard that takes over its
+     * keys */
+    while (!shardedPub.WaitForResult(shardId)) {
+        if (!shardedPub.RemoveShard(shardId) ||
+            !shardedPub.Publish(request, shardId))
+            return false;
+
+        std::cerr << "Publisher: key " << request.mKey
+                  << ", sequence " << request.mSequence
+                  << " published again to shard " << shardId << std::endl;
+    }
+
+    std::cerr << "Publisher: result received from shard " << shardId
+              << ": " << shardedPub.GetResult(shardId) << std::endl;
+
+    return true;
+}
+
+static bool SendRequests(PublisherType& shardedPub, int& sequence)
+{
+    /* Requests with the same key go to the same shard and are processed
+     * in order */
+    for (int key = 0; key < 4; ++key) {
+        for (int i = 0; i < 2; ++i) {
+            ShardRequest request = { key, sequence++ };
+
+            if (!SendRequest(shardedPub, request))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    PublisherType shardedPub;
+    int sequence = 0;
+
+    if (!shardedPub.Initialize("/test_sharded", 2)) {
+        std::cerr << "Publisher: initialization failed"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cerr << "Publisher: started with "
+              << shardedPub.NumShards() << " shards" << std::endl;
+
+    if (!SendRequests(shardedPub, sequence)) {
+        std::cerr << "Publisher: failed to send requests" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    /* Worker of the new shard is test_sharded_subscriber 2 */
+    unsigned int shardId;
+
+    if (!shardedPub.AddShard(shardId)) {
+        std::cerr << "Publisher: failed to add shard" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cerr << "Publisher: shard " << shardId << " added" << std::endl;
+
+    if (!SendRequests(shardedPub, sequence)) {
+        std::cerr << "Publisher: failed to send requests" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!shardedPub.RemoveShard(0)) {
+        std::cerr << "Publisher: failed to remove shard" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cerr << "Publisher: shard 0 removed" << std::endl;
+
+    if (!SendRequests(shardedPub, sequence)) {
+        std::cerr << "Publisher: failed to send requests" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    shardedPub.Stop();
+    std::cerr << "Publisher: stopped" << std::endl;
+
+    shardedPub.Destroy();
+
+    return EXIT_SUCCESS;
+}
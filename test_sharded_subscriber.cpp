@@ -0,0 +1,44 @@
+
+/* test_sharded_subscriber.cpp */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "shm_comm.h"
+#include "test_sharded_types.h"
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <shard (0, 1 or 2)>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string sharedMemoryName = std::string("/test_sharded.") + argv[1];
+    DataSubscriber<ShardRequest, int> dataSub;
+
+    if (!dataSub.Initialize(sharedMemoryName.c_str())) {
+        std::cerr << "Subscriber " << argv[1] << ": initialization failed"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cerr << "Subscriber " << argv[1] << ": started" << std::endl;
+
+    while (dataSub.Subscribe()) {
+        const ShardRequest& request = dataSub.GetData();
+        std::cerr << "Subscriber " << argv[1] << ": key " << request.mKey
+                  << ", sequence " << request.mSequence << std::endl;
+
+        int resultData = request.mSequence;
+        dataSub.SendResult(resultData);
+    }
+
+    std::cerr << "Subscriber " << argv[1] << ": exiting" << std::endl;
+
+    dataSub.Destroy();
+
+    return EXIT_SUCCESS;
+}
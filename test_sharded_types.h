@@ -0,0 +1,24 @@
+
+/* test_sharded_types.h */
+
+#ifndef TEST_SHARDED_TYPES_H
+#define TEST_SHARDED_TYPES_H
+
+/*
+ * Types shared by the sharded publisher and its workers
+ */
+
+/* Requests are routed by their key */
+struct ShardRequest
+{
+    int mKey;
+    int mSequence;
+};
+
+struct ShardRequestKey
+{
+    inline int operator()(const ShardRequest& request) const
+    { return request.mKey; }
+};
+
+#endif /* TEST_SHARDED_TYPES_H */
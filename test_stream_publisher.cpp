@@ -0,0 +1,56 @@
+
+/* test_stream_publisher.cpp */
+
+#include <cstdlib>
+#include <iostream>
+
+#include "shm_comm.h"
+
+int main(int argc, char** argv)
+{
+    const char* sharedMemoryName = "/test_stream";
+    DataPublisher<int, StreamResult<int, 4>> dataPub;
+
+    if (!dataPub.Initialize(sharedMemoryName)) {
+        std::cerr << "Publisher: initialization failed"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cerr << "Publisher: started" << std::endl;
+
+    for (int i = 0; i < 3; ++i) {
+        /* Request more partial results than the ring holds */
+        int publishedData = 10 + i;
+        dataPub.Publish(publishedData);
+        std::cerr << "Publisher: data published: "
+                  << publishedData << std::endl;
+
+        /* Final result arrives through the ring after the partial
+         * results, but is passed to its own callback */
+        dataPub.ForEachPartial(
+            [](int partialData) {
+                std::cerr << "Publisher: partial result received: "
+                          << partialData << std::endl;
+            },
+            [](int finalData) {
+                std::cerr << "Publisher: final result received: "
+                          << finalData << std::endl;
+            });
+    }
+
+    /* Partial results may also be ignored */
+    int publishedData = 10;
+    int resultData;
+    dataPub.Publish(publishedData);
+    dataPub.WaitForResult(resultData);
+    std::cerr << "Publisher: final result received: "
+              << resultData << std::endl;
+
+    dataPub.Stop();
+    std::cerr << "Publisher: stopped" << std::endl;
+
+    dataPub.Destroy();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,44 @@
+
+/* test_stream_subscriber.cpp */
+
+#include <cstdlib>
+#include <iostream>
+
+#include "shm_comm.h"
+
+int main(int argc, char** argv)
+{
+    const char* sharedMemoryName = "/test_stream";
+    DataSubscriber<int, StreamResult<int, 4>> dataSub;
+
+    if (!dataSub.Initialize(sharedMemoryName)) {
+        std::cerr << "Subscriber: initialization failed"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cerr << "Subscriber: started" << std::endl;
+
+    while (dataSub.Subscribe()) {
+        int receivedData = dataSub.GetData();
+        int finalData = 0;
+        std::cerr << "Subscriber: data received: "
+                  << receivedData << std::endl;
+
+        /* Send squares as they are computed, then their sum */
+        for (int i = 0; i < receivedData; ++i) {
+            dataSub.SendPartial(i * i);
+            finalData += i * i;
+        }
+
+        dataSub.SendFinal(finalData);
+        std::cerr << "Subscriber: final result sent: "
+                  << finalData << std::endl;
+    }
+
+    std::cerr << "Subscriber: exiting" << std::endl;
+
+    dataSub.Destroy();
+
+    return EXIT_SUCCESS;
+}